@@ -4,7 +4,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
-#define ABI_VERSION 2
+#define ABI_VERSION 7
 
 #define MAX_PROPERTIES (64) // (6 bits)
 #define WRITE_HEADER_LEN 1  // Write header is 1 bytes long: [HEADER]
@@ -29,6 +29,7 @@ typedef enum __attribute__((__packed__)) {
 #define GENERATE_PROPERTY_NAME(ENUM, NAME, SIZE) NAME,
 #define GENERATE_PROPERTY_SIZE(ENUM, NAME, SIZE) SIZE,
 
+// The model writes the properties of a pass in this order, so characterDelay reaches a module before its character.
 #define MODULE_PROPERTY(PROPERTY)                                                                                      \
     PROPERTY(no_property, NULL, 0)                                                                                     \
     PROPERTY(firmware_property, "firmware", 130)                                                                       \
@@ -38,8 +39,14 @@ typedef enum __attribute__((__packed__)) {
     PROPERTY(characterMap_property, "characterMap", 200)                                                               \
     PROPERTY(offset_property, "offset", 1)                                                                             \
     PROPERTY(vtrim_property, "vtrim", 1)                                                                               \
+    PROPERTY(characterDelay_property, "characterDelay", 2)                                                             \
     PROPERTY(character_property, "character", 1)                                                                       \
     PROPERTY(baseSpeed_property, "baseSpeed", 1)                                                                       \
+    PROPERTY(configChecksum_property, "configChecksum", 2)                                                             \
+    PROPERTY(flapPeriod_property, "flapPeriod", 2)                                                                     \
+    PROPERTY(encoderStats_property, "encoderStats", 26)                                                                \
+    PROPERTY(irLimits_property, "irLimits", 12)                                                                        \
+    PROPERTY(fault_property, "fault", 1)                                                                               \
     PROPERTY(end_of_properties, NULL, 0)
 
 typedef enum __attribute__((__packed__)) { MODULE_PROPERTY(GENERATE_PROPERTY_ENUM) } moduleProperty_t;
@@ -68,7 +75,14 @@ typedef struct {
 
 typedef enum {
     no_command,
-    reboot_command, // reboot the modules
+    reboot_command,    // reboot the modules
+    calibrate_command, // turn the modules one revolution while they record the encoder statistics
 } moduleCommand_t;
 
+// Flags of the fault property, a module clears them when it gets a new character.
+typedef enum {
+    fault_none = 0,
+    fault_stall = 1 << 0, // the wheel did not turn after every retry, the module gave up on its character
+} moduleFault_t;
+
 #endif
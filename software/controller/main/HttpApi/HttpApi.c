@@ -9,15 +9,15 @@ static const char *TAG = "[HTTP_API]";
         return false;                                                                                                  \
     }
 
-bool columnEnd_toJson(cJSON **json, module_t *module)
+bool columnEnd_toJson(http_jsonWriter_t *writer, module_t *module)
 {
-    *json = cJSON_CreateBool(module_getColumnEnd(module));
+    http_jsonWriteBool(writer, module_getColumnEnd(module));
     return true;
 }
 
-bool character_toJson(cJSON **json, module_t *module)
+bool character_toJson(http_jsonWriter_t *writer, module_t *module)
 {
-    *json = cJSON_CreateString(module_getCharacter(module));
+    http_jsonWriteString(writer, module_getCharacter(module), 4); // characters are not null terminated in the map.
     return true;
 }
 
@@ -28,28 +28,30 @@ bool character_fromJson(cJSON **json, module_t *module)
     return true;
 }
 
-bool characterMapSize_toJson(cJSON **json, module_t *module)
+bool characterMapSize_toJson(http_jsonWriter_t *writer, module_t *module)
 {
-    *json = cJSON_CreateNumber(module_getCharacterMap(module)->size);
+    http_jsonWriteNumber(writer, module_getCharacterMapSize(module));
     return true;
 }
 
-bool characterMap_toJson(cJSON **json, module_t *module)
+bool characterMap_toJson(http_jsonWriter_t *writer, module_t *module)
 {
-    *json = cJSON_CreateArray();
     characterMap_t *characterMap = module_getCharacterMap(module);
-    char character[5] = {0};
-    for (int i = 0; i < characterMap->size; i++) {
-        characterMap_getCharacter(characterMap, i, character);
-        cJSON *characterMapMember = cJSON_CreateString(character);
-        cJSON_AddItemToArray(*json, characterMapMember);
+    http_jsonWriteRaw(writer, "[", 1);
+    for (int i = 0; characterMap && i < characterMap->size; i++) {
+        if (i) {
+            http_jsonWriteRaw(writer, ",", 1);
+        }
+        http_jsonWriteString(writer, &characterMap->character[i * 4], 4);
     }
+    http_jsonWriteRaw(writer, "]", 1);
     return true;
 }
 
 bool characterMap_fromJson(cJSON **json, module_t *module)
 {
     GUARD(!(cJSON_IsArray(*json)), "property must be an array");
+    GUARD(cJSON_GetArraySize(*json) > 48, "property must not contain more than 48 characters");
     characterMap_t *characterMap = characterMap_new(48);
     GUARD(!characterMap, "Failed to create a new characterMap");
     cJSON *map_it = NULL;
@@ -69,9 +71,9 @@ bool characterMap_fromJson(cJSON **json, module_t *module)
     return true;
 }
 
-bool offset_toJson(cJSON **json, module_t *module)
+bool offset_toJson(http_jsonWriter_t *writer, module_t *module)
 {
-    *json = cJSON_CreateNumber(module_getOffset(module));
+    http_jsonWriteNumber(writer, module_getOffset(module));
     return true;
 }
 
@@ -83,9 +85,9 @@ bool offset_fromJson(cJSON **json, module_t *module)
     return true;
 }
 
-bool vtrim_toJson(cJSON **json, module_t *module)
+bool vtrim_toJson(http_jsonWriter_t *writer, module_t *module)
 {
-    *json = cJSON_CreateNumber(module_getVtrim(module));
+    http_jsonWriteNumber(writer, module_getVtrim(module));
     return true;
 }
 
@@ -97,9 +99,9 @@ bool vtrim_fromJson(cJSON **json, module_t *module)
     return true;
 }
 
-bool baseSpeed_toJson(cJSON **json, module_t *module)
+bool baseSpeed_toJson(http_jsonWriter_t *writer, module_t *module)
 {
-    *json = cJSON_CreateNumber(module_getBaseSpeed(module));
+    http_jsonWriteNumber(writer, module_getBaseSpeed(module));
     return true;
 }
 
@@ -111,6 +113,55 @@ bool baseSpeed_fromJson(cJSON **json, module_t *module)
     return true;
 }
 
+bool configChecksum_toJson(http_jsonWriter_t *writer, module_t *module)
+{
+    http_jsonWriteNumber(writer, module_getConfigChecksum(module));
+    return true;
+}
+
+bool flapPeriod_toJson(http_jsonWriter_t *writer, module_t *module)
+{
+    http_jsonWriteNumber(writer, module_getFlapPeriod(module));
+    return true;
+}
+
+bool irLimits_toJson(http_jsonWriter_t *writer, module_t *module)
+{
+    const uint16_t *irLimits = module_getIrLimits(module);
+    http_jsonWriteRaw(writer, "[", 1);
+    for (int i = 0; i < MODULE_IR_SENSOR_CNT; i++) {
+        if (i) {
+            http_jsonWriteRaw(writer, ",", 1);
+        }
+        http_jsonWriteNumber(writer, irLimits[i]);
+    }
+    http_jsonWriteRaw(writer, "]", 1);
+    return true;
+}
+
+bool irLimits_fromJson(cJSON **json, module_t *module)
+{
+    GUARD(!(cJSON_IsArray(*json) && cJSON_GetArraySize(*json) == MODULE_IR_SENSOR_CNT),
+          "property must be an array of %d numbers", MODULE_IR_SENSOR_CNT);
+    uint16_t irLimits[MODULE_IR_SENSOR_CNT];
+    cJSON *limit_it = NULL;
+    int i = 0;
+    cJSON_ArrayForEach(limit_it, *json)
+    {
+        GUARD(!(cJSON_IsNumber(limit_it) && limit_it->valueint >= 0 && limit_it->valueint <= 0x3ff),
+              "limit must be a number in range [0-1023]");
+        irLimits[i++] = limit_it->valueint;
+    }
+    module_setIrLimits(module, irLimits);
+    return true;
+}
+
+bool fault_toJson(http_jsonWriter_t *writer, module_t *module)
+{
+    http_jsonWriteNumber(writer, module_getFault(module));
+    return true;
+}
+
 void http_moduleEndpointInit()
 {
     http_addModulePropertyHandler(columnEnd_property, columnEnd_toJson, NULL);
@@ -120,4 +171,8 @@ void http_moduleEndpointInit()
     http_addModulePropertyHandler(offset_property, offset_toJson, offset_fromJson);
     http_addModulePropertyHandler(vtrim_property, vtrim_toJson, vtrim_fromJson);
     http_addModulePropertyHandler(baseSpeed_property, baseSpeed_toJson, baseSpeed_fromJson);
+    http_addModulePropertyHandler(configChecksum_property, configChecksum_toJson, NULL);
+    http_addModulePropertyHandler(flapPeriod_property, flapPeriod_toJson, NULL);
+    http_addModulePropertyHandler(irLimits_property, irLimits_toJson, irLimits_fromJson);
+    http_addModulePropertyHandler(fault_property, fault_toJson, NULL);
 }
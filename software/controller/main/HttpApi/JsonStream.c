@@ -0,0 +1,278 @@
+#include "JsonStream.h"
+
+#include <string.h>
+
+#include "esp_log.h"
+
+static const char *TAG = "[JSON]";
+
+void jsonStream_init(jsonStream_t *stream, jsonStream_callback_t callback, void *arg)
+{
+    memset(stream, 0, sizeof(jsonStream_t));
+    stream->state = jsonStream_stateValue;
+    stream->callback = callback;
+    stream->arg = arg;
+}
+
+bool jsonStream_isDone(jsonStream_t *stream)
+{
+    return stream->state == jsonStream_stateDone;
+}
+
+static bool jsonStream_emit(jsonStream_t *stream, jsonStream_event_t event)
+{
+    stream->token[stream->tokenLen] = '\0';
+    bool ok = stream->callback(event, stream->token, stream->tokenLen, stream->arg);
+    stream->tokenLen = 0;
+    return ok;
+}
+
+static bool jsonStream_append(jsonStream_t *stream, char c)
+{
+    if (stream->tokenLen >= JSON_STREAM_TOKEN_LEN) {
+        ESP_LOGW(TAG, "Token exceeds %d bytes", JSON_STREAM_TOKEN_LEN);
+        return false;
+    }
+    stream->token[stream->tokenLen++] = c;
+    return true;
+}
+
+static bool jsonStream_appendCodepoint(jsonStream_t *stream, uint32_t codepoint)
+{
+    if (codepoint < 0x80) {
+        return jsonStream_append(stream, codepoint);
+    } else if (codepoint < 0x800) {
+        return jsonStream_append(stream, 0xc0 | (codepoint >> 6)) &&
+               jsonStream_append(stream, 0x80 | (codepoint & 0x3f));
+    } else if (codepoint < 0x10000) {
+        return jsonStream_append(stream, 0xe0 | (codepoint >> 12)) &&
+               jsonStream_append(stream, 0x80 | ((codepoint >> 6) & 0x3f)) &&
+               jsonStream_append(stream, 0x80 | (codepoint & 0x3f));
+    }
+    return jsonStream_append(stream, 0xf0 | (codepoint >> 18)) &&
+           jsonStream_append(stream, 0x80 | ((codepoint >> 12) & 0x3f)) &&
+           jsonStream_append(stream, 0x80 | ((codepoint >> 6) & 0x3f)) &&
+           jsonStream_append(stream, 0x80 | (codepoint & 0x3f));
+}
+
+// Characters beyond the basic multilingual plane are escaped as a pair of surrogates, which form a single character.
+static bool jsonStream_unicodeDone(jsonStream_t *stream)
+{
+    uint32_t codepoint = stream->codepoint;
+    stream->state = jsonStream_stateString;
+    if (codepoint >= 0xd800 && codepoint <= 0xdbff) {
+        if (stream->highSurrogate) {
+            return false;
+        }
+        stream->highSurrogate = codepoint;
+        return true;
+    } else if (codepoint >= 0xdc00 && codepoint <= 0xdfff) {
+        if (!stream->highSurrogate) {
+            return false;
+        }
+        codepoint = 0x10000 + ((uint32_t)(stream->highSurrogate - 0xd800) << 10) + (codepoint - 0xdc00);
+        stream->highSurrogate = 0;
+    } else if (stream->highSurrogate) {
+        return false;
+    }
+    return jsonStream_appendCodepoint(stream, codepoint);
+}
+
+// Called after a complete value, selects what may follow it.
+static void jsonStream_valueDone(jsonStream_t *stream)
+{
+    stream->state = stream->depth ? jsonStream_stateCommaOrEnd : jsonStream_stateDone;
+}
+
+static bool jsonStream_open(jsonStream_t *stream, bool isObject)
+{
+    if (stream->depth >= JSON_STREAM_MAX_DEPTH) {
+        ESP_LOGW(TAG, "Json is nested too deep");
+        return false;
+    }
+    stream->depth++;
+    stream->objects = (stream->objects & ~(1u << stream->depth)) | ((uint32_t)isObject << stream->depth);
+    stream->state = isObject ? jsonStream_stateKeyOrEnd : jsonStream_stateValueOrEnd;
+    return jsonStream_emit(stream, isObject ? jsonStream_objectStart : jsonStream_arrayStart);
+}
+
+static bool jsonStream_close(jsonStream_t *stream, bool isObject)
+{
+    if (!stream->depth || ((stream->objects >> stream->depth) & 1) != isObject) {
+        return false;
+    }
+    stream->depth--;
+    jsonStream_valueDone(stream);
+    return jsonStream_emit(stream, isObject ? jsonStream_objectEnd : jsonStream_arrayEnd);
+}
+
+static bool jsonStream_literalDone(jsonStream_t *stream)
+{
+    stream->token[stream->tokenLen] = '\0';
+    jsonStream_valueDone(stream);
+    if (strcmp(stream->token, "true") == 0) {
+        return jsonStream_emit(stream, jsonStream_true);
+    } else if (strcmp(stream->token, "false") == 0) {
+        return jsonStream_emit(stream, jsonStream_false);
+    } else if (strcmp(stream->token, "null") == 0) {
+        return jsonStream_emit(stream, jsonStream_null);
+    }
+    return false;
+}
+
+static bool jsonStream_isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static bool jsonStream_parseChar(jsonStream_t *stream, char c)
+{
+    switch (stream->state) {
+        case jsonStream_stateNumber:
+            if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E') {
+                return jsonStream_append(stream, c);
+            }
+            jsonStream_valueDone(stream);
+            if (!jsonStream_emit(stream, jsonStream_number)) {
+                return false;
+            }
+            return jsonStream_parseChar(stream, c); // the terminating character belongs to the next token.
+        case jsonStream_stateLiteral:
+            if (c >= 'a' && c <= 'z') {
+                return jsonStream_append(stream, c);
+            }
+            if (!jsonStream_literalDone(stream)) {
+                return false;
+            }
+            return jsonStream_parseChar(stream, c);
+        case jsonStream_stateString:
+            if (stream->highSurrogate && c != '\\') {
+                return false; // a high surrogate must be followed by its low surrogate.
+            }
+            if (c == '"') {
+                if (stream->isKey) {
+                    stream->state = jsonStream_stateColon;
+                    return jsonStream_emit(stream, jsonStream_key);
+                }
+                jsonStream_valueDone(stream);
+                return jsonStream_emit(stream, jsonStream_string);
+            } else if (c == '\\') {
+                stream->state = jsonStream_stateEscape;
+                return true;
+            } else if ((uint8_t)c < 0x20) {
+                return false;
+            }
+            return jsonStream_append(stream, c);
+        case jsonStream_stateEscape:
+            stream->state = jsonStream_stateString;
+            if (stream->highSurrogate && c != 'u') {
+                return false;
+            }
+            switch (c) {
+                case 'b':
+                    return jsonStream_append(stream, '\b');
+                case 'f':
+                    return jsonStream_append(stream, '\f');
+                case 'n':
+                    return jsonStream_append(stream, '\n');
+                case 'r':
+                    return jsonStream_append(stream, '\r');
+                case 't':
+                    return jsonStream_append(stream, '\t');
+                case 'u':
+                    stream->state = jsonStream_stateUnicode;
+                    stream->codepoint = 0;
+                    stream->codepointDigits = 0;
+                    return true;
+                case '"':
+                case '\\':
+                case '/':
+                    return jsonStream_append(stream, c);
+                default:
+                    return false;
+            }
+        case jsonStream_stateUnicode:
+            stream->codepoint <<= 4;
+            if (c >= '0' && c <= '9') {
+                stream->codepoint |= c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                stream->codepoint |= c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                stream->codepoint |= c - 'A' + 10;
+            } else {
+                return false;
+            }
+            if (++stream->codepointDigits == 4) {
+                return jsonStream_unicodeDone(stream);
+            }
+            return true;
+        default:
+            break;
+    }
+
+    if (jsonStream_isSpace(c)) {
+        return true;
+    }
+
+    switch (stream->state) {
+        case jsonStream_stateValueOrEnd:
+            if (c == ']') {
+                return jsonStream_close(stream, false);
+            }
+            // fall through
+        case jsonStream_stateValue:
+            if (c == '{' || c == '[') {
+                return jsonStream_open(stream, c == '{');
+            } else if (c == '"') {
+                stream->state = jsonStream_stateString;
+                stream->isKey = false;
+                return true;
+            } else if ((c >= '0' && c <= '9') || c == '-') {
+                stream->state = jsonStream_stateNumber;
+                return jsonStream_append(stream, c);
+            } else if (c >= 'a' && c <= 'z') {
+                stream->state = jsonStream_stateLiteral;
+                return jsonStream_append(stream, c);
+            }
+            return false;
+        case jsonStream_stateKeyOrEnd:
+            if (c == '}') {
+                return jsonStream_close(stream, true);
+            }
+            // fall through
+        case jsonStream_stateKey:
+            if (c == '"') {
+                stream->state = jsonStream_stateString;
+                stream->isKey = true;
+                return true;
+            }
+            return false;
+        case jsonStream_stateColon:
+            if (c == ':') {
+                stream->state = jsonStream_stateValue;
+                return true;
+            }
+            return false;
+        case jsonStream_stateCommaOrEnd:
+            if (c == ',') {
+                stream->state = (stream->objects >> stream->depth) & 1 ? jsonStream_stateKey : jsonStream_stateValue;
+                return true;
+            } else if (c == '}' || c == ']') {
+                return jsonStream_close(stream, c == '}');
+            }
+            return false;
+        default:
+            return false; // nothing may follow a complete value.
+    }
+}
+
+bool jsonStream_feed(jsonStream_t *stream, const char *data, size_t len)
+{
+    for (size_t i = 0; i < len && stream->state != jsonStream_stateError; i++) {
+        if (!jsonStream_parseChar(stream, data[i])) {
+            ESP_LOGW(TAG, "Failed to parse json at '%c'", data[i]);
+            stream->state = jsonStream_stateError;
+        }
+    }
+    return stream->state != jsonStream_stateError;
+}
@@ -0,0 +1,170 @@
+#include "Multipart.h"
+
+#include <string.h>
+
+#include "esp_log.h"
+
+static const char *TAG = "[MULTIPART]";
+
+bool multipart_init(multipart_t *multipart, const char *contentType, multipart_partCallback_t partCallback,
+                    multipart_dataCallback_t dataCallback, void *arg)
+{
+    memset(multipart, 0, sizeof(multipart_t));
+    multipart->partCallback = partCallback;
+    multipart->dataCallback = dataCallback;
+    multipart->arg = arg;
+    multipart->state = multipart_stateError;
+
+    const char *boundary = contentType ? strstr(contentType, "boundary=") : NULL;
+    if (!boundary) {
+        ESP_LOGE(TAG, "Content type has no boundary");
+        return false;
+    }
+    boundary += strlen("boundary=");
+    size_t len;
+    if (*boundary == '"') {
+        boundary++;
+        len = strcspn(boundary, "\"");
+    } else {
+        len = strcspn(boundary, "; \t");
+    }
+    if (!len || len > MULTIPART_BOUNDARY_LEN) {
+        ESP_LOGE(TAG, "Boundary has an invalid length of %d bytes", len);
+        return false;
+    }
+    memcpy(multipart->delimiter, "\r\n--", 4);
+    memcpy(multipart->delimiter + 4, boundary, len);
+    multipart->delimiterLen = len + 4;
+    // the body starts with the first delimiter, which is not preceded by a line break.
+    multipart->match = 2;
+    multipart->state = multipart_statePreamble;
+    return true;
+}
+
+bool multipart_isDone(multipart_t *multipart)
+{
+    return multipart->state == multipart_stateDone;
+}
+
+static bool multipart_output(multipart_t *multipart, const char *data, size_t len)
+{
+    if (multipart->state != multipart_stateBody) {
+        return true; // the preamble is discarded.
+    }
+    while (len) {
+        size_t n = MULTIPART_OUT_LEN - multipart->outLen;
+        n = n < len ? n : len;
+        memcpy(multipart->out + multipart->outLen, data, n);
+        multipart->outLen += n;
+        data += n;
+        len -= n;
+        if (multipart->outLen == MULTIPART_OUT_LEN) {
+            if (!multipart->dataCallback(multipart->out, multipart->outLen, false, multipart->arg)) {
+                return false;
+            }
+            multipart->outLen = 0;
+        }
+    }
+    return true;
+}
+
+// Scans for the delimiter, everything in front of it is part data. Returns the number of bytes consumed.
+static size_t multipart_parseBody(multipart_t *multipart, const char *data, size_t len)
+{
+    size_t runStart = 0;
+    for (size_t i = 0; i < len; i++) {
+        char c = data[i];
+        if (c == multipart->delimiter[multipart->match]) {
+            if (multipart->match == 0 && !multipart_output(multipart, data + runStart, i - runStart)) {
+                return 0;
+            }
+            runStart = i + 1;
+            if (++multipart->match == multipart->delimiterLen) {
+                if (multipart->state == multipart_stateBody &&
+                    !multipart->dataCallback(multipart->out, multipart->outLen, true, multipart->arg)) {
+                    return 0;
+                }
+                multipart->outLen = 0;
+                multipart->match = 0;
+                multipart->delimiterEndLen = 0;
+                multipart->state = multipart_stateDelimiterEnd;
+                return i + 1;
+            }
+        } else if (multipart->match) {
+            // the matched bytes were data after all. The boundary holds no '\r', so only c can start a new match.
+            if (!multipart_output(multipart, multipart->delimiter, multipart->match)) {
+                return 0;
+            }
+            multipart->match = c == multipart->delimiter[0];
+            runStart = multipart->match ? i + 1 : i;
+        }
+    }
+    if (!multipart->match && !multipart_output(multipart, data + runStart, len - runStart)) {
+        return 0;
+    }
+    return len;
+}
+
+static bool multipart_parseHeaders(multipart_t *multipart)
+{
+    multipart->header[multipart->headerLen] = '\0';
+    multipart->name[0] = '\0';
+    const char *name = strstr(multipart->header, "name=\"");
+    if (name) {
+        name += strlen("name=\"");
+        size_t len = strcspn(name, "\"");
+        len = len < MULTIPART_NAME_LEN - 1 ? len : MULTIPART_NAME_LEN - 1;
+        memcpy(multipart->name, name, len);
+        multipart->name[len] = '\0';
+    }
+    return multipart->partCallback(multipart->name, multipart->arg);
+}
+
+bool multipart_feed(multipart_t *multipart, const char *data, size_t len)
+{
+    size_t i = 0;
+    while (i < len) {
+        switch (multipart->state) {
+            case multipart_statePreamble:
+            case multipart_stateBody: {
+                size_t n = multipart_parseBody(multipart, data + i, len - i);
+                if (!n) {
+                    multipart->state = multipart_stateError;
+                    return false;
+                }
+                i += n;
+                break;
+            }
+            case multipart_stateDelimiterEnd:
+                // a delimiter is followed by "--" for the last part or by a line break for the next part.
+                multipart->delimiterEnd[multipart->delimiterEndLen++] = data[i++];
+                if (multipart->delimiterEndLen == 2) {
+                    if (memcmp(multipart->delimiterEnd, "--", 2) == 0) {
+                        multipart->state = multipart_stateDone;
+                    } else if (memcmp(multipart->delimiterEnd, "\r\n", 2) == 0) {
+                        multipart->headerLen = 0;
+                        multipart->state = multipart_stateHeaders;
+                    } else {
+                        multipart->state = multipart_stateError;
+                    }
+                }
+                break;
+            case multipart_stateHeaders:
+                if (multipart->headerLen == MULTIPART_HEADER_LEN) {
+                    ESP_LOGE(TAG, "Part headers exceed %d bytes", MULTIPART_HEADER_LEN);
+                    multipart->state = multipart_stateError;
+                    break;
+                }
+                multipart->header[multipart->headerLen++] = data[i++];
+                if (multipart->headerLen >= 4 && memcmp(multipart->header + multipart->headerLen - 4, "\r\n\r\n", 4) == 0) {
+                    multipart->state = multipart_parseHeaders(multipart) ? multipart_stateBody : multipart_stateError;
+                }
+                break;
+            case multipart_stateDone:
+                return true; // the epilogue is ignored.
+            default:
+                return false;
+        }
+    }
+    return multipart->state != multipart_stateError;
+}
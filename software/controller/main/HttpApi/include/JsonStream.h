@@ -0,0 +1,62 @@
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define JSON_STREAM_TOKEN_LEN 64 // longest key, string or number that can be reported.
+#define JSON_STREAM_MAX_DEPTH 16
+
+typedef enum {
+    jsonStream_objectStart,
+    jsonStream_objectEnd,
+    jsonStream_arrayStart,
+    jsonStream_arrayEnd,
+    jsonStream_key,
+    jsonStream_string,
+    jsonStream_number,
+    jsonStream_true,
+    jsonStream_false,
+    jsonStream_null,
+} jsonStream_event_t;
+
+// token is null terminated and only valid during the callback. Returning false aborts parsing.
+typedef bool (*jsonStream_callback_t)(jsonStream_event_t event, const char *token, size_t len, void *arg);
+
+typedef enum {
+    jsonStream_stateValue,
+    jsonStream_stateValueOrEnd,
+    jsonStream_stateKey,
+    jsonStream_stateKeyOrEnd,
+    jsonStream_stateColon,
+    jsonStream_stateCommaOrEnd,
+    jsonStream_stateString,
+    jsonStream_stateEscape,
+    jsonStream_stateUnicode,
+    jsonStream_stateNumber,
+    jsonStream_stateLiteral,
+    jsonStream_stateDone,
+    jsonStream_stateError,
+} jsonStream_state_t;
+
+// Incremental json parser, the document can be fed in chunks of any size and is parsed in constant memory.
+typedef struct {
+    jsonStream_state_t state;
+    bool isKey;
+    uint8_t depth;
+    uint32_t objects; // bit n is set when the container at depth n is an object.
+    uint32_t codepoint;
+    uint16_t highSurrogate; // first half of a \u surrogate pair, waiting for the second half.
+    uint8_t codepointDigits;
+    size_t tokenLen;
+    char token[JSON_STREAM_TOKEN_LEN + 1];
+    jsonStream_callback_t callback;
+    void *arg;
+} jsonStream_t;
+
+void jsonStream_init(jsonStream_t *stream, jsonStream_callback_t callback, void *arg);
+bool jsonStream_feed(jsonStream_t *stream, const char *data, size_t len); // returns false on a syntax error or abort.
+bool jsonStream_isDone(jsonStream_t *stream); // true when a complete json value has been parsed.
+
+#endif
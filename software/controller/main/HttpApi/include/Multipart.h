@@ -0,0 +1,51 @@
+#ifndef MULTIPART_H
+#define MULTIPART_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MULTIPART_BOUNDARY_LEN 70 // longest boundary allowed by RFC 2046.
+#define MULTIPART_HEADER_LEN   512
+#define MULTIPART_NAME_LEN     32
+#define MULTIPART_OUT_LEN      4096 // part data is passed on in blocks of this size.
+
+// Called when the headers of a part are parsed, name holds the name of the form field.
+typedef bool (*multipart_partCallback_t)(const char *name, void *arg);
+// Called with the data of the current part. final is set for the last block of the part.
+typedef bool (*multipart_dataCallback_t)(const char *data, size_t len, bool final, void *arg);
+
+typedef enum {
+    multipart_statePreamble,
+    multipart_stateDelimiterEnd,
+    multipart_stateHeaders,
+    multipart_stateBody,
+    multipart_stateDone,
+    multipart_stateError,
+} multipart_state_t;
+
+// Incremental multipart/form-data parser, the body can be fed in chunks of any size.
+typedef struct {
+    multipart_state_t state;
+    char delimiter[MULTIPART_BOUNDARY_LEN + 4]; // "\r\n--" followed by the boundary.
+    size_t delimiterLen;
+    size_t match; // number of delimiter bytes matched so far.
+    char delimiterEnd[2];
+    size_t delimiterEndLen;
+    char header[MULTIPART_HEADER_LEN + 1];
+    size_t headerLen;
+    char name[MULTIPART_NAME_LEN];
+    size_t outLen;
+    char out[MULTIPART_OUT_LEN];
+    multipart_partCallback_t partCallback;
+    multipart_dataCallback_t dataCallback;
+    void *arg;
+} multipart_t;
+
+// contentType is the value of the Content-Type header, it must hold the boundary of the body.
+bool multipart_init(multipart_t *multipart, const char *contentType, multipart_partCallback_t partCallback,
+                    multipart_dataCallback_t dataCallback, void *arg);
+bool multipart_feed(multipart_t *multipart, const char *data, size_t len); // returns false on a malformed body.
+bool multipart_isDone(multipart_t *multipart); // true when the closing delimiter has been parsed.
+
+#endif
@@ -2,16 +2,299 @@
 #define DO_GENERATE_PROPERTY_NAMES
 #include "Model.h"
 #include "flap_http_server.h"
+#include "flap_nvs.h"
 #include "flap_uart.h"
 
 static const char *TAG = "[MODEL]";
 
 static OpenFlapModel_ctx_t ctx;
 
+static const TickType_t propertyTtl[end_of_properties] = {
+    [firmware_property] = MODEL_TTL_STATIC,
+    [columnEnd_property] = MODEL_TTL_STATIC,
+    [characterMapSize_property] = MODEL_TTL_STATIC,
+    [characterMap_property] = MODEL_TTL_STATIC,
+    [offset_property] = MODEL_TTL_CONFIG_MS / portTICK_RATE_MS,
+    [vtrim_property] = MODEL_TTL_CONFIG_MS / portTICK_RATE_MS,
+    [character_property] = MODEL_TTL_CHARACTER_MS / portTICK_RATE_MS,
+    [baseSpeed_property] = MODEL_TTL_CONFIG_MS / portTICK_RATE_MS,
+    [configChecksum_property] = MODEL_TTL_CONFIG_MS / portTICK_RATE_MS,
+    [flapPeriod_property] = MODEL_TTL_CONFIG_MS / portTICK_RATE_MS,
+    [encoderStats_property] = 0, // changes while the modules calibrate, always read again.
+    [irLimits_property] = MODEL_TTL_CONFIG_MS / portTICK_RATE_MS,
+    [fault_property] = MODEL_TTL_CHARACTER_MS / portTICK_RATE_MS,
+};
+
+static void model_transactionDone(moduleProperty_t property, bool success, void *arg)
+{
+    if (!success) {
+        ESP_LOGE(TAG, "Transaction for property %s failed", get_property_name(property));
+    } else if ((uart_transactionType_t)(uintptr_t)arg == transaction_readAll) {
+        display_lock();
+        ctx.controller->display.cachedProperties |= (1 << property);
+        ctx.controller->display.propertyReadTick[property] = xTaskGetTickCount();
+        display_unlock();
+    }
+    xSemaphoreGive(ctx.transactionDone);
+}
+
+static bool model_submitTransaction(uart_transactionType_t type, moduleProperty_t property)
+{
+    uart_transaction_t transaction = {
+        .type = type,
+        .property = property,
+        // the writes of a pass share a priority, so they reach the modules in property order.
+        .priority = type == transaction_readAll ? transaction_priorityLow : transaction_priorityHigh,
+        .callback = model_transactionDone,
+        .arg = (void *)(uintptr_t)type,
+    };
+    return uart_transactionSubmit(&transaction);
+}
+
+static void model_awaitTransactions(int count)
+{
+    while (count-- > 0) {
+        if (xSemaphoreTake(ctx.transactionDone, 10000 / portTICK_RATE_MS) != pdTRUE) {
+            ESP_LOGE(TAG, "Timeout while waiting for %d chain transactions", count + 1);
+            return;
+        }
+    }
+}
+
+static void model_readProperties(uint64_t properties)
+{
+    int transactionCnt = 0;
+    for (moduleProperty_t property = no_property + 1; property < end_of_properties; property++) {
+        if (properties & (1 << property)) {
+            ESP_LOGI(TAG, "read property: %d %s", property, get_property_name(property));
+            transactionCnt += model_submitTransaction(transaction_readAll, property);
+        }
+    }
+    model_awaitTransactions(transactionCnt);
+}
+
+// Reads the properties from every chain. When a chain changed size while the chains behind it were read, these are
+// read again at their new index.
+static void model_readPropertiesOfAllChains(uint64_t properties)
+{
+    model_readProperties(properties);
+    if (uart_takeModulesMoved()) {
+        ESP_LOGI(TAG, "Modules moved to another index, reading properties again");
+        model_readProperties(properties);
+    }
+}
+
+// Layout of the snapshot: the header, the interned characterMaps as [size][size * 4 characters] and the state of each
+// module.
+typedef struct __attribute__((packed)) {
+    uint8_t version;
+    uint8_t abiVersion;
+    uint16_t moduleCnt;
+    uint8_t characterMapCnt;
+} model_snapshotHeader_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t configChecksum;
+    uint8_t characterMap; // index of the interned characterMap.
+    uint8_t offset;
+    uint8_t vtrim;
+    uint8_t baseSpeed;
+    uint8_t colEnd;
+} model_snapshotModule_t;
+
+static uint32_t model_snapshotHash(const uint8_t *snapshot, size_t len)
+{
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ snapshot[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void model_loadSnapshot()
+{
+    void *snapshot = NULL;
+    size_t len = 0;
+    if (flap_nvs_get_blob(MODEL_SNAPSHOT_KEY, &snapshot, &len) != ESP_OK) {
+        return;
+    }
+    model_snapshotHeader_t *header = snapshot;
+    if (len < sizeof(model_snapshotHeader_t) || header->version != MODEL_SNAPSHOT_VERSION ||
+        header->abiVersion != ABI_VERSION) {
+        ESP_LOGW(TAG, "Discarding snapshot of another version");
+        free(snapshot);
+        return;
+    }
+    ctx.snapshot = snapshot;
+    ctx.snapshotLen = len;
+}
+
+// Reads the configChecksum of every module and restores the snapshot when the chain has not changed since it was
+// taken. Returns the properties that are now held by the front frame.
+static uint64_t model_restoreSnapshot()
+{
+    uint8_t *snapshot = ctx.snapshot;
+    size_t len = ctx.snapshotLen;
+    ctx.snapshot = NULL; // the snapshot is only restored once, after that the chain is discovered as usual.
+    model_snapshotHeader_t *header = (model_snapshotHeader_t *)snapshot;
+    Display_t *display = &ctx.controller->display;
+    characterMap_t **characterMaps = calloc(header->characterMapCnt, sizeof(characterMap_t *));
+    uint64_t restoredProperties = 0;
+
+    model_readPropertiesOfAllChains(1 << configChecksum_property);
+
+    size_t pos = sizeof(model_snapshotHeader_t);
+    bool valid = characterMaps || !header->characterMapCnt;
+    for (int i = 0; valid && i < header->characterMapCnt; i++) {
+        size_t size = pos < len ? snapshot[pos] : 0;
+        valid = size && pos + 1 + 4 * size <= len && (characterMaps[i] = characterMap_new(size));
+        if (valid) {
+            memcpy(characterMaps[i]->character, &snapshot[pos + 1], 4 * size);
+            pos += 1 + 4 * size;
+        }
+    }
+    model_snapshotModule_t *modules = (model_snapshotModule_t *)&snapshot[pos];
+    valid = valid && pos + header->moduleCnt * sizeof(model_snapshotModule_t) == len;
+
+    display_lock();
+    valid = valid && display->size == header->moduleCnt && (display->cachedProperties & (1 << configChecksum_property));
+    for (size_t i = 0; valid && i < display->size; i++) {
+        valid = display->module[i].configChecksum == modules[i].configChecksum &&
+                modules[i].characterMap < header->characterMapCnt;
+    }
+    if (valid) {
+        for (size_t i = 0; i < display->size; i++) {
+            module_t *module = &display->module[i];
+            characterMaps[modules[i].characterMap]->reffCnt++;
+            module_setCharacterMap(module, characterMaps[modules[i].characterMap]);
+            module_setColumnEnd(module, modules[i].colEnd);
+            module_setOffset(module, modules[i].offset);
+            module_setVtrim(module, modules[i].vtrim);
+            module_setBaseSpeed(module, modules[i].baseSpeed);
+            module->updatableProperties = 0; // the modules already hold these values.
+        }
+        TickType_t now = xTaskGetTickCount();
+        for (moduleProperty_t property = no_property + 1; property < end_of_properties; property++) {
+            if (MODEL_SNAPSHOT_PROPERTIES & (1 << property)) {
+                display->propertyReadTick[property] = now;
+            }
+        }
+        display->cachedProperties |= MODEL_SNAPSHOT_PROPERTIES;
+        restoredProperties = MODEL_SNAPSHOT_PROPERTIES;
+    }
+    display_unlock();
+
+    if (valid) {
+        ESP_LOGI(TAG, "Restored the snapshot of %d modules", header->moduleCnt);
+        for (size_t i = 0; i < header->moduleCnt; i++) {
+            modules[i].configChecksum = 0;
+        }
+        ctx.snapshotHash = model_snapshotHash(snapshot, len);
+    } else {
+        ESP_LOGI(TAG, "The chain has changed since the snapshot was taken");
+    }
+    for (int i = 0; characterMaps && i < header->characterMapCnt; i++) {
+        characterMap_delete(characterMaps[i]);
+    }
+    free(characterMaps);
+    free(snapshot);
+    return restoredProperties | (1 << configChecksum_property);
+}
+
+// Stores a snapshot when the snapshot properties of every module are known and have changed since the last snapshot.
+static void model_storeSnapshot()
+{
+    Display_t *display = &ctx.controller->display;
+    display_lock();
+    if (!display->size || (display->cachedProperties & MODEL_SNAPSHOT_PROPERTIES) != MODEL_SNAPSHOT_PROPERTIES) {
+        display_unlock();
+        return;
+    }
+    size_t moduleCnt = display->size;
+    characterMap_t **characterMaps = malloc(moduleCnt * sizeof(characterMap_t *));
+    uint8_t *characterMapIndex = malloc(moduleCnt);
+    size_t characterMapCnt = 0;
+    size_t len = sizeof(model_snapshotHeader_t) + moduleCnt * sizeof(model_snapshotModule_t);
+    bool valid = characterMaps && characterMapIndex;
+    for (size_t i = 0; valid && i < moduleCnt; i++) {
+        characterMap_t *characterMap = display->module[i].characterMap;
+        size_t j = 0;
+        while (j < characterMapCnt && characterMaps[j] != characterMap) {
+            j++; // equal characterMaps are interned, so they are the same object.
+        }
+        valid = characterMap && characterMap->size && j <= UINT8_MAX;
+        if (valid && j == characterMapCnt) {
+            characterMaps[characterMapCnt++] = characterMap;
+            len += 1 + 4 * characterMap->size;
+        }
+        characterMapIndex[i] = j;
+    }
+    uint8_t *snapshot = valid ? malloc(len) : NULL;
+    if (snapshot) {
+        model_snapshotHeader_t *header = (model_snapshotHeader_t *)snapshot;
+        header->version = MODEL_SNAPSHOT_VERSION;
+        header->abiVersion = ABI_VERSION;
+        header->moduleCnt = moduleCnt;
+        header->characterMapCnt = characterMapCnt;
+        size_t pos = sizeof(model_snapshotHeader_t);
+        for (size_t i = 0; i < characterMapCnt; i++) {
+            snapshot[pos] = characterMaps[i]->size;
+            memcpy(&snapshot[pos + 1], characterMaps[i]->character, 4 * characterMaps[i]->size);
+            pos += 1 + 4 * characterMaps[i]->size;
+        }
+        model_snapshotModule_t *modules = (model_snapshotModule_t *)&snapshot[pos];
+        for (size_t i = 0; i < moduleCnt; i++) {
+            module_t *module = &display->module[i];
+            modules[i] = (model_snapshotModule_t){
+                .configChecksum = 0,
+                .characterMap = characterMapIndex[i],
+                .offset = module_getOffset(module),
+                .vtrim = module_getVtrim(module),
+                .baseSpeed = module_getBaseSpeed(module),
+                .colEnd = module_getColumnEnd(module),
+            };
+        }
+    }
+    display_unlock();
+    free(characterMaps);
+    free(characterMapIndex);
+    if (!snapshot) {
+        return;
+    }
+
+    uint32_t hash = model_snapshotHash(snapshot, len);
+    if (hash != ctx.snapshotHash) {
+        // the checksums are read after the state was copied, so they cover the state that is stored.
+        model_readPropertiesOfAllChains(1 << configChecksum_property);
+        model_snapshotModule_t *modules =
+            (model_snapshotModule_t *)&snapshot[len - moduleCnt * sizeof(model_snapshotModule_t)];
+        display_lock();
+        bool valid = display->size == moduleCnt;
+        for (size_t i = 0; valid && i < moduleCnt; i++) {
+            modules[i].configChecksum = module_getConfigChecksum(&display->module[i]);
+        }
+        display_unlock();
+        if (valid && flap_nvs_set_blob(MODEL_SNAPSHOT_KEY, snapshot, len) == ESP_OK) {
+            ESP_LOGI(TAG, "Stored a snapshot of %d modules", moduleCnt);
+            ctx.snapshotHash = hash;
+        }
+    }
+    free(snapshot);
+}
+
 static void OpenFlapModelTask(void *arg)
 {
     while (1) {
         if (ulTaskNotifyTake(true, 250 / portTICK_RATE_MS) == fromHttp) {
+            // give a burst of requests the chance to update the back frame, only their latest state is sent.
+            vTaskDelay(MODEL_COALESCE_WINDOW_MS / portTICK_RATE_MS);
+            ulTaskNotifyTake(true, 0);
+            TaskHandle_t waiters[MODEL_MAX_WAITERS];
+            xSemaphoreTake(ctx.waiterLock, portMAX_DELAY);
+            size_t waiterCnt = ctx.waiterCnt;
+            memcpy(waiters, ctx.waiters, waiterCnt * sizeof(TaskHandle_t));
+            ctx.waiterCnt = 0;
+            xSemaphoreGive(ctx.waiterLock);
 
             // if (ctx.controller->display.requestedProperties) {
             //     // send command to switch from bootloader to application
@@ -22,15 +305,28 @@ static void OpenFlapModelTask(void *arg)
             //     ulTaskNotifyTake(true, 5000 / portTICK_RATE_MS); // wait for command to finish
             // }
 
-            ESP_LOGI(TAG, "Requested properties: 0x%08llx", ctx.controller->display.requestedProperties);
-            for (moduleProperty_t property = no_property + 1; property < end_of_properties; property++) {
-                if (ctx.controller->display.requestedProperties & (1 << property)) {
-                    ctx.controller->display.requestedProperties ^= (1 << property);
-                    ESP_LOGI(TAG, "read property: %d %s", property, get_property_name(property));
-                    uart_propertyReadAll(property);
-                }
+            while (xSemaphoreTake(ctx.transactionDone, 0) == pdTRUE) {
+                // discard completions of transactions that previously timed out.
             }
 
+            display_lock();
+            uint64_t requestedProperties = ctx.controller->display.requestedProperties;
+            ctx.controller->display.requestedProperties = 0;
+            display_unlock();
+
+            uint64_t restoredProperties = 0;
+            if (ctx.snapshot && (requestedProperties & MODEL_SNAPSHOT_PROPERTIES)) {
+                restoredProperties = model_restoreSnapshot();
+                requestedProperties &= ~restoredProperties;
+            }
+
+            ESP_LOGI(TAG, "Requested properties: 0x%08llx", requestedProperties);
+            model_readPropertiesOfAllChains(requestedProperties);
+            // publish the read properties to the back frame and take over the pending writes of the back frame.
+            display_syncBackFrame(requestedProperties | restoredProperties);
+            display_swapFrames();
+            display_applyTransition();
+
             // handle write updates
             uint64_t updatableProperties = no_property;
             uint64_t updatablePropertiesWriteAll = no_property;
@@ -41,7 +337,7 @@ static void OpenFlapModelTask(void *arg)
             }
             for (moduleProperty_t property = no_property + 1; property < end_of_properties; property++) {
                 updatablePropertiesWriteAll |=
-                    ((updatableProperties & (1 << property) && uart_moduleSerializedPropertiesAreEqual(property))
+                    ((updatableProperties & (1 << property) && display_modulePropertiesAreEqual(property))
                      << property);
             }
             updatablePropertiesWriteSequential = updatableProperties ^ updatablePropertiesWriteAll;
@@ -49,17 +345,31 @@ static void OpenFlapModelTask(void *arg)
             ESP_LOGI(TAG, "Updatable properties with WriteAll command: 0x%04llX", updatablePropertiesWriteAll);
             ESP_LOGI(TAG, "Updatable properties with WriteSequential command: 0x%04llX",
                      updatablePropertiesWriteSequential);
+            // the transactions are queued at once and pipelined by the uart transaction task of every chain.
+            int transactionCnt = 0;
             for (moduleProperty_t property = no_property + 1; property < end_of_properties; property++) {
                 if (updatablePropertiesWriteAll & (1 << property)) {
                     ESP_LOGI(TAG, "updateing property: %d", property);
-                    uart_propertyWriteAll(property);
+                    transactionCnt += model_submitTransaction(transaction_writeAll, property);
                 } else if (updatablePropertiesWriteSequential & (1 << property)) {
                     ESP_LOGI(TAG, "updateing property: %d", property);
-                    uart_propertyWriteSequential(property);
+                    transactionCnt += model_submitTransaction(transaction_writeSequential, property);
                 }
             }
-            // finished all model updates
-            xTaskNotify(httpTask(), 1, eSetValueWithoutOverwrite);
+            model_awaitTransactions(transactionCnt);
+            http_publishModuleChanges();
+            // finished all model updates, release every request served by this pass.
+            for (size_t i = 0; i < waiterCnt; i++) {
+                xTaskNotify(waiters[i], 1, eSetValueWithoutOverwrite);
+            }
+            if ((requestedProperties | updatableProperties) & MODEL_SNAPSHOT_PROPERTIES) {
+                model_storeSnapshot();
+            }
+            if ((updatableProperties & (1 << character_property)) &&
+                display_getStaleModuleProperties(1 << flapPeriod_property)) {
+                // the flap periods are refreshed after the waiters are released, they serve the next prediction.
+                model_readPropertiesOfAllChains(1 << flapPeriod_property);
+            }
         }
     }
 }
@@ -73,13 +383,49 @@ void flap_model_init(void)
 {
     ctx.controller = controller_new();
     ctx.controller->display.requestedProperties = 0;
+    ctx.transactionDone = xSemaphoreCreateCounting(2 * TRANSACTION_QUEUE_LEN, 0);
+    ctx.waiterLock = xSemaphoreCreateMutex();
+    ctx.waiterCnt = 0;
+    model_loadSnapshot();
     xTaskCreate(OpenFlapModelTask, "OpenFlap Model task", 6000, NULL, 10, &ctx.task);
 }
 
-void model_preformUart()
+void model_requestUpdate()
 {
     xTaskNotify(modelTask(), fromHttp, eSetValueWithoutOverwrite);
-    ulTaskNotifyTake(true, 10000 / portTICK_RATE_MS);
+}
+
+bool model_preformUart()
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTake(true, 0); // clear stale completion notifications.
+
+    xSemaphoreTake(ctx.waiterLock, portMAX_DELAY);
+    bool registered = ctx.waiterCnt < MODEL_MAX_WAITERS;
+    if (registered) {
+        ctx.waiters[ctx.waiterCnt++] = self;
+    }
+    xSemaphoreGive(ctx.waiterLock);
+    if (!registered) {
+        ESP_LOGE(TAG, "Too many tasks are waiting for the model");
+        return false;
+    }
+
+    xTaskNotify(modelTask(), fromHttp, eSetValueWithoutOverwrite);
+    if (ulTaskNotifyTake(true, 10000 / portTICK_RATE_MS)) {
+        return true;
+    }
+
+    // the model did not respond, make sure it will not notify this task later on.
+    xSemaphoreTake(ctx.waiterLock, portMAX_DELAY);
+    for (size_t i = 0; i < ctx.waiterCnt; i++) {
+        if (ctx.waiters[i] == self) {
+            ctx.waiters[i] = ctx.waiters[--ctx.waiterCnt];
+            break;
+        }
+    }
+    xSemaphoreGive(ctx.waiterLock);
+    return false;
 }
 
 // Controller
@@ -93,6 +439,13 @@ controller_t *controller_new()
     }
     controller->display.size = 0;
     controller->display.module = NULL;
+    controller->display.backModule = NULL;
+    controller->display.width = 0;
+    controller->display.height = 0;
+    controller->display.moduleAt = NULL;
+    controller->display.geometryValid = false;
+    controller->display.frameLock = xSemaphoreCreateRecursiveMutex();
+    controller->display.cachedProperties = 0;
     controller->modulesPowered = false;        // getRelayState
     controller->firmwareVersion = __VERSION__; // getFwVersion
     return controller;
@@ -106,13 +459,22 @@ void controller_delete(controller_t *controller)
             module_delete(&(controller->display.module[i]));
         }
     }
+    if (controller->display.backModule) {
+        for (int i = 0; i < controller->display.size; i++) {
+            module_delete(&(controller->display.backModule[i]));
+        }
+    }
+    free(controller->display.moduleAt);
+    vSemaphoreDelete(controller->display.frameLock);
 }
 
 // Display
 
 void display_requestModuleProperty(moduleProperty_t property)
 {
+    display_lock();
     ctx.controller->display.requestedProperties |= (1 << property);
+    display_unlock();
 }
 
 uint64_t display_getRequestModuleProperties()
@@ -120,6 +482,44 @@ uint64_t display_getRequestModuleProperties()
     return ctx.controller->display.requestedProperties;
 }
 
+uint64_t display_getStaleModuleProperties(uint64_t properties)
+{
+    Display_t *display = &ctx.controller->display;
+    uint64_t staleProperties = 0;
+    TickType_t now = xTaskGetTickCount();
+    display_lock();
+    for (moduleProperty_t property = no_property + 1; property < end_of_properties; property++) {
+        if (!(properties & (1 << property))) {
+            continue;
+        }
+        if (!(display->cachedProperties & (1 << property)) ||
+            (propertyTtl[property] != MODEL_TTL_STATIC &&
+             now - display->propertyReadTick[property] >= propertyTtl[property])) {
+            staleProperties |= (1 << property);
+        }
+    }
+    display_unlock();
+    return staleProperties;
+}
+
+bool display_refreshModuleProperties(uint64_t properties)
+{
+    uint64_t staleProperties = display_getStaleModuleProperties(properties);
+    for (moduleProperty_t property = no_property + 1; property < end_of_properties; property++) {
+        if (staleProperties & (1 << property)) {
+            display_requestModuleProperty(property);
+        }
+    }
+    return !staleProperties || model_preformUart();
+}
+
+void display_invalidateModuleProperties(uint64_t properties)
+{
+    display_lock();
+    ctx.controller->display.cachedProperties &= ~properties;
+    display_unlock();
+}
+
 bool display_getPowered()
 {
     return gpio_get_level(FLAP_ENABLE_PIN);
@@ -139,40 +539,480 @@ module_t *display_getModule(size_t index)
     return ctx.controller->display.module + index;
 }
 
+module_t *display_getBackModule(size_t index)
+{
+    if (index >= display_getSize()) {
+        ESP_LOGE(TAG, "Module index %i is out of range.", index);
+        return NULL;
+    }
+    return ctx.controller->display.backModule + index;
+}
+
+void display_lock()
+{
+    xSemaphoreTakeRecursive(ctx.controller->display.frameLock, portMAX_DELAY);
+}
+
+void display_unlock()
+{
+    xSemaphoreGiveRecursive(ctx.controller->display.frameLock);
+}
+
+static void module_copyProperty(module_t *dst, module_t *src, moduleProperty_t property)
+{
+    switch (property) {
+        case columnEnd_property:
+            module_setColumnEnd(dst, module_getColumnEnd(src));
+            break;
+        case characterMapSize_property:
+        case characterMap_property:
+            if (src->characterMap && src->characterMap != dst->characterMap) {
+                src->characterMap->reffCnt++; // the map is shared between both frames.
+                module_setCharacterMap(dst, src->characterMap);
+            }
+            break;
+        case offset_property:
+            module_setOffset(dst, module_getOffset(src));
+            break;
+        case vtrim_property:
+            module_setVtrim(dst, module_getVtrim(src));
+            break;
+        case character_property:
+            module_setCharacterIndex(dst, module_getCharacterIndex(src));
+            break;
+        case baseSpeed_property:
+            module_setBaseSpeed(dst, module_getBaseSpeed(src));
+            break;
+        case characterDelay_property:
+            module_setCharacterDelay(dst, module_getCharacterDelay(src));
+            break;
+        case configChecksum_property:
+            module_setConfigChecksum(dst, module_getConfigChecksum(src));
+            break;
+        case flapPeriod_property:
+            module_setFlapPeriod(dst, module_getFlapPeriod(src));
+            break;
+        case command_property:
+            module_setCommand(dst, module_getCommand(src));
+            break;
+        case encoderStats_property:
+            module_setEncoderStats(dst, module_getEncoderStats(src));
+            break;
+        case irLimits_property:
+            module_setIrLimits(dst, module_getIrLimits(src));
+            break;
+        case fault_property:
+            module_setFault(dst, module_getFault(src));
+            break;
+        default:
+            break;
+    }
+}
+
+// Predicts when a module shows a new character. A module that is still turning starts from where it is estimated to be.
+static void module_predictArrival(module_t *module, uint8_t characterIndex)
+{
+    uint8_t size = module_getCharacterMapSize(module);
+    uint32_t period = module->flapPeriod ? module->flapPeriod : MODEL_DEFAULT_FLAP_PERIOD_MS;
+    uint32_t distance = 0;
+    if (size) {
+        uint32_t remainingFlaps = module_getEtaMs(module) / period; // flaps left of the previous move.
+        uint32_t position = (module->characterIndex + size - remainingFlaps % size) % size;
+        distance = (characterIndex + size - position) % size;
+    }
+    module->arrivalTick = xTaskGetTickCount() + pdMS_TO_TICKS(MODEL_WRITE_LATENCY_MS + distance * period);
+}
+
+void display_swapFrames()
+{
+    Display_t *display = &ctx.controller->display;
+    display_lock();
+    for (size_t i = 0; i < display->size; i++) {
+        module_t *back = &display->backModule[i];
+        if (back->updatableProperties & (1 << character_property)) {
+            // the module retries a stalled motor on a new character.
+            module_setFault(&display->module[i], module_getFault(&display->module[i]) & ~fault_stall);
+            module_predictArrival(&display->module[i], module_getCharacterIndex(back));
+            back->arrivalTick = display->module[i].arrivalTick; // the api reports the eta from the back frame.
+        }
+        for (moduleProperty_t property = no_property + 1; property < end_of_properties; property++) {
+            if (back->updatableProperties & (1 << property)) {
+                module_copyProperty(&display->module[i], back, property);
+            }
+        }
+        back->updatableProperties = 0;
+    }
+    display_unlock();
+}
+
+void display_syncBackFrame(uint64_t properties)
+{
+    Display_t *display = &ctx.controller->display;
+    display_lock();
+    for (size_t i = 0; i < display->size; i++) {
+        module_t *back = &display->backModule[i];
+        uint64_t pendingProperties = back->updatableProperties; // pending writes win over the read values.
+        for (moduleProperty_t property = no_property + 1; property < end_of_properties; property++) {
+            if (properties & ~pendingProperties & (1 << property)) {
+                module_copyProperty(back, &display->module[i], property);
+            }
+        }
+        back->updatableProperties = pendingProperties;
+    }
+    display_unlock();
+}
+
 bool display_setSize(size_t size)
 {
     Display_t *display = &ctx.controller->display;
     if (display->size == size) {
         return true;
     }
+    display_lock();
     size_t oldSize = display->size;
     display->size = size;
+    display->cachedProperties = 0; // the modules have changed, discover them again.
+    display->geometryValid = false;
     ESP_LOGI(TAG, "Changing display size from %d to %d", oldSize, display->size);
     display->module = realloc(display->module, display->size * sizeof(module_t));
-    if (display->module == NULL) {
+    display->backModule = realloc(display->backModule, display->size * sizeof(module_t));
+    if (display->module == NULL || display->backModule == NULL) {
         ESP_LOGE(TAG, "Failed to allocate memory for new display size.");
+        display_unlock();
         return false;
     }
     int newMem = (long)display->size - (long)oldSize;
     if (newMem > 0) {
         memset(&(display->module[oldSize]), 0, newMem * sizeof(module_t));
+        memset(&(display->backModule[oldSize]), 0, newMem * sizeof(module_t));
     }
+    display_unlock();
     return true;
 }
 
-bool display_setMessage(Display_t *display, char *message)
+// Splits the modules into columns at the modules with colEnd set. The modules of a column are ordered from top to
+// bottom.
+static void display_updateGeometry()
 {
-    return true;
+    Display_t *display = &ctx.controller->display;
+    display_lock();
+    if (display->geometryValid) {
+        display_unlock();
+        return;
+    }
+    size_t width = 0;
+    size_t height = 0;
+    size_t columnLen = 0;
+    for (size_t i = 0; i < display->size; i++) {
+        columnLen++;
+        if (display->module[i].colEnd || i + 1 == display->size) {
+            width++;
+            height = columnLen > height ? columnLen : height;
+            columnLen = 0;
+        }
+    }
+    int16_t *moduleAt = realloc(display->moduleAt, width * height * sizeof(int16_t));
+    if (width && !moduleAt) {
+        ESP_LOGE(TAG, "Failed to allocate memory for the display geometry.");
+        display_unlock();
+        return;
+    }
+    display->moduleAt = moduleAt;
+    display->width = width;
+    display->height = height;
+    size_t column = 0;
+    size_t row = 0;
+    for (size_t i = 0; i < width * height; i++) {
+        moduleAt[i] = -1;
+    }
+    for (size_t i = 0; i < display->size; i++) {
+        moduleAt[column * height + row++] = i;
+        if (display->module[i].colEnd) {
+            column++;
+            row = 0;
+        }
+    }
+    display->geometryValid = true;
+    if (width && display->size != width * height) {
+        ESP_LOGW(TAG, "The display of %d modules is not rectangular", display->size);
+    }
+    display_unlock();
 }
 
 size_t display_getWidth()
 {
-    return ctx.controller->display.size;
+    display_updateGeometry();
+    return ctx.controller->display.width;
 }
 
 size_t display_getHeight()
 {
-    return ctx.controller->display.size;
+    display_updateGeometry();
+    return ctx.controller->display.height;
+}
+
+int display_getModuleIndex(size_t column, size_t row)
+{
+    Display_t *display = &ctx.controller->display;
+    display_lock();
+    display_updateGeometry();
+    int index = column < display->width && row < display->height ? display->moduleAt[column * display->height + row]
+                                                                 : -1;
+    display_unlock();
+    return index;
+}
+
+static const char display_space[4] = " ";
+
+static bool display_isSpace(const char *character)
+{
+    return !memcmp(character, display_space, 4);
+}
+
+bool display_parseAlign(const char *names, display_textLayout_t *layout)
+{
+    static const char *alignNames[] = {[display_alignLeft] = "left", [display_alignCenter] = "center",
+                                       [display_alignRight] = "right"};
+    const size_t alignNameCnt = sizeof(alignNames) / sizeof(alignNames[0]);
+    layout->alignCnt = 0;
+    while (*names && layout->alignCnt < DISPLAY_TEXT_MAX_ALIGN) {
+        size_t len = strcspn(names, ",");
+        size_t align = 0;
+        while (align < alignNameCnt && (strlen(alignNames[align]) != len || strncmp(names, alignNames[align], len))) {
+            align++;
+        }
+        if (align == alignNameCnt) {
+            return false;
+        }
+        layout->align[layout->alignCnt++] = align;
+        names += names[len] ? len + 1 : len;
+    }
+    return true;
+}
+
+bool display_parseWrap(const char *name, display_textLayout_t *layout)
+{
+    if (strcmp(name, "word") == 0) {
+        layout->wrap = display_wrapWord;
+    } else if (strcmp(name, "char") == 0) {
+        layout->wrap = display_wrapCharacter;
+    } else if (strcmp(name, "none") == 0) {
+        layout->wrap = display_wrapNone;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Lays out a row of text, the modules around the text show a space.
+static bool display_layoutTextRow(int16_t *indices, size_t row, const char *characters, size_t len,
+                                  display_align_t align)
+{
+    size_t width = ctx.controller->display.width;
+    size_t offset = align == display_alignRight ? width - len : align == display_alignCenter ? (width - len) / 2 : 0;
+    bool valid = true;
+    for (size_t x = 0; x < width; x++) {
+        int module = display_getModuleIndex(x, row);
+        if (module < 0) {
+            continue;
+        }
+        characterMap_t *characterMap = display_getBackModule(module)->characterMap;
+        uint8_t from = display_getBackModule(module)->characterIndex; // duplicates are chosen for the shortest turn.
+        const char *character = x >= offset && x < offset + len ? &characters[4 * (x - offset)] : display_space;
+        int index = characterMap_getNearestIndex(characterMap, character, from);
+        if (index < 0 && character[0] >= 'a' && character[0] <= 'z' && !character[1]) {
+            char upper[4] = {character[0] - 'a' + 'A'};
+            index = characterMap_getNearestIndex(characterMap, upper, from);
+        }
+        if (index < 0) {
+            valid &= display_isSpace(character);
+            index = characterMap_getNearestIndex(characterMap, display_space, from);
+        }
+        indices[module] = index;
+    }
+    return valid;
+}
+
+bool display_layoutMessage(const char *message, const display_textLayout_t *layout, int16_t *indices)
+{
+    Display_t *display = &ctx.controller->display;
+    display_lock();
+    for (size_t i = 0; i < display->size; i++) {
+        indices[i] = -1;
+    }
+    char *characters = malloc(4 * strlen(message) + 4); // a character takes at least one byte of the message.
+    if (!characters) {
+        ESP_LOGE(TAG, "Failed to allocate memory for the text layout.");
+        display_unlock();
+        return false;
+    }
+    display_updateGeometry();
+    size_t width = display->width;
+    size_t height = display->height;
+    size_t row = layout->row;
+    size_t textRow = 0;
+    bool valid = width > 0;
+    if (layout->clear) {
+        for (size_t y = 0; y < row && y < height; y++) {
+            display_layoutTextRow(indices, y, NULL, 0, display_alignLeft);
+        }
+    }
+    const char *line = message;
+    while (width && row < height) {
+        size_t cnt = 0;
+        while (*line && *line != '\n') {
+            if (*line == '\r') {
+                line++;
+                continue;
+            }
+            size_t n = utf8_getCharacter(line, &characters[4 * cnt++]);
+            line += n ? n : 1;
+        }
+        size_t pos = 0;
+        do {
+            size_t len = cnt - pos;
+            if (len > width) {
+                len = width;
+                if (layout->wrap == display_wrapWord) {
+                    size_t wordEnd = width; // a space right after the last column still lets the words fit.
+                    while (wordEnd && !display_isSpace(&characters[4 * (pos + wordEnd)])) {
+                        wordEnd--;
+                    }
+                    len = wordEnd ? wordEnd : width;
+                }
+            }
+            size_t textLen = len; // trailing spaces do not count for the alignment.
+            while (textLen && display_isSpace(&characters[4 * (pos + textLen - 1)])) {
+                textLen--;
+            }
+            size_t alignIndex = textRow < layout->alignCnt ? textRow : layout->alignCnt - 1;
+            display_align_t align = layout->alignCnt ? layout->align[alignIndex] : display_alignLeft;
+            valid &= display_layoutTextRow(indices, row++, &characters[4 * pos], textLen, align);
+            textRow++;
+            pos += len;
+            while (layout->wrap == display_wrapWord && pos < cnt && display_isSpace(&characters[4 * pos])) {
+                pos++;
+            }
+        } while (layout->wrap != display_wrapNone && pos < cnt && row < height);
+        if (*line++ != '\n') {
+            break;
+        }
+    }
+    if (layout->clear) {
+        for (; row < height; row++) {
+            display_layoutTextRow(indices, row, NULL, 0, display_alignLeft);
+        }
+    }
+    display_unlock();
+    free(characters);
+    return valid;
+}
+
+void display_setCharacterIndices(const int16_t *indices, size_t cnt)
+{
+    display_lock(); // changes are written to the back frame, the model task publishes them.
+    for (size_t i = 0; i < cnt && i < ctx.controller->display.size; i++) {
+        module_t *backModule = display_getBackModule(i);
+        if (indices[i] >= 0 && indices[i] < module_getCharacterMapSize(backModule)) {
+            module_setCharacterIndex(backModule, indices[i]);
+        }
+    }
+    display_unlock();
+}
+
+bool display_setMessage(const char *message, const display_textLayout_t *layout)
+{
+    display_lock(); // the size of the display must not change between the layout and the write.
+    size_t size = display_getSize();
+    if (!size) {
+        display_unlock();
+        return false; // there is no module to show the text.
+    }
+    int16_t *indices = malloc(size * sizeof(int16_t));
+    bool valid = indices && display_layoutMessage(message, layout, indices);
+    if (indices) {
+        display_setCharacterIndices(indices, size);
+        free(indices);
+    }
+    display_unlock();
+    return valid;
+}
+
+void display_setTransition(const Transition_t *transition)
+{
+    display_lock();
+    ctx.controller->display.transition = *transition;
+    display_unlock();
+}
+
+bool display_parseTransition(const char *name, Transition_t *transition)
+{
+    static const char *transitionNames[] = {[transition_none] = "none", [transition_wave] = "wave",
+                                            [transition_sweep] = "sweep", [transition_cascade] = "cascade"};
+    for (size_t type = 0; type < sizeof(transitionNames) / sizeof(transitionNames[0]); type++) {
+        if (strcmp(name, transitionNames[type]) == 0) {
+            transition->type = type;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Gives every module with a new character the delay after which it starts to turn. The delay follows from the position
+// of the module, so a transition costs one write of the delays in the same pass as the characters.
+void display_applyTransition()
+{
+    Display_t *display = &ctx.controller->display;
+    display_lock();
+    Transition_t transition = display->transition;
+    display->transition.type = transition_none;
+    if (transition.type == transition_none) {
+        display_unlock();
+        return;
+    }
+    display_updateGeometry();
+    uint32_t random = xTaskGetTickCount() | 1;
+    for (size_t x = 0; x < display->width; x++) {
+        for (size_t y = 0; y < display->height; y++) {
+            int i = display->moduleAt[x * display->height + y];
+            if (i < 0 || !(display->module[i].updatableProperties & (1 << character_property))) {
+                continue;
+            }
+            uint32_t delay = 0;
+            switch (transition.type) {
+                case transition_wave:
+                    delay = display->width > 1 ? x * transition.durationMs / (display->width - 1) : 0;
+                    break;
+                case transition_sweep:
+                    delay = display->height > 1 ? y * transition.durationMs / (display->height - 1) : 0;
+                    break;
+                case transition_cascade:
+                    random ^= random << 13; // xorshift32
+                    random ^= random >> 17;
+                    random ^= random << 5;
+                    delay = random % (transition.durationMs + 1);
+                    break;
+                default:
+                    break;
+            }
+            module_setCharacterDelay(&display->module[i], delay);
+            display->module[i].arrivalTick += pdMS_TO_TICKS(delay);
+            display->backModule[i].arrivalTick = display->module[i].arrivalTick;
+        }
+    }
+    display_unlock();
+}
+
+uint32_t display_getEtaMs()
+{
+    uint32_t eta = 0;
+    display_lock();
+    for (size_t i = 0; i < display_getSize(); i++) {
+        uint32_t moduleEta = module_getEtaMs(display_getModule(i));
+        eta = moduleEta > eta ? moduleEta : eta;
+    }
+    display_unlock();
+    return eta;
 }
 
 size_t display_getSize()
@@ -180,6 +1020,32 @@ size_t display_getSize()
     return ctx.controller->display.size;
 }
 
+// The hash of a property larger than 32 bits only tells that it changed, equal values are compared by content.
+static bool module_propertiesAreEqual(module_t *a, module_t *b, moduleProperty_t property)
+{
+    switch (property) {
+        case characterMap_property:
+            return a->characterMap == b->characterMap; // equal characterMaps are interned.
+        case encoderStats_property:
+            return !memcmp(&a->encoderStats, &b->encoderStats, sizeof(encoderStats_t));
+        case irLimits_property:
+            return !memcmp(a->irLimits, b->irLimits, sizeof(a->irLimits));
+        default:
+            return a->propertyHash[property] == b->propertyHash[property];
+    }
+}
+
+bool display_modulePropertiesAreEqual(moduleProperty_t property)
+{
+    Display_t *display = &ctx.controller->display;
+    for (int i = 1; i < display->size; i++) {
+        if (!module_propertiesAreEqual(&display->module[i], &display->module[0], property)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 // Charsets
 
 characterMap_t *characterMap_new(size_t size)
@@ -191,6 +1057,10 @@ characterMap_t *characterMap_new(size_t size)
     }
     characterMap->size = size;
     characterMap->reffCnt = 1;
+    characterMap->lookup = NULL;
+    characterMap->lookupMask = 0;
+    characterMap->hash = 0;
+    characterMap->hasDuplicates = false;
     characterMap->character = calloc(size, 4 * sizeof(char));
     if (characterMap->character == NULL) {
         ESP_LOGE(TAG, "Failed to allocate memory for Charset characters");
@@ -208,6 +1078,9 @@ void characterMap_delete(characterMap_t *characterMap)
             if (characterMap->character) {
                 free(characterMap->character);
             }
+            if (characterMap->lookup) {
+                free(characterMap->lookup);
+            }
             free(characterMap);
         }
     }
@@ -232,6 +1105,105 @@ bool characterMap_isEqual(characterMap_t *a, characterMap_t *b)
     return true;
 }
 
+static inline uint32_t characterMap_hash(const char *character)
+{
+    uint32_t key;
+    memcpy(&key, character, 4);
+    return (key * 0x9E3779B1u) >> 16; // Fibonacci hashing, the upper bits are the best mixed.
+}
+
+bool characterMap_buildLookup(characterMap_t *characterMap)
+{
+    size_t slots = 4;
+    while (slots < 2 * characterMap->size) {
+        slots <<= 1;
+    }
+    uint8_t *lookup = calloc(slots, sizeof(uint8_t));
+    if (lookup == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate memory for Charset lookup table");
+        return false;
+    }
+    if (characterMap->lookup) {
+        free(characterMap->lookup);
+    }
+    characterMap->lookup = lookup;
+    characterMap->lookupMask = slots - 1;
+    characterMap->hasDuplicates = false;
+    characterMap->hash = 2166136261u; // FNV-1a
+    for (int i = 0; i < characterMap->size * 4; i++) {
+        characterMap->hash = (characterMap->hash ^ (uint8_t)characterMap->character[i]) * 16777619u;
+    }
+    for (int i = 0; i < characterMap->size; i++) {
+        const char *character = &characterMap->character[4 * i];
+        uint32_t slot = characterMap_hash(character) & characterMap->lookupMask;
+        while (lookup[slot]) {
+            if (!memcmp(&characterMap->character[4 * (lookup[slot] - 1)], character, 4)) {
+                characterMap->hasDuplicates = true; // the first index is kept.
+                break;
+            }
+            slot = (slot + 1) & characterMap->lookupMask;
+        }
+        if (!lookup[slot]) {
+            lookup[slot] = i + 1;
+        }
+    }
+    return true;
+}
+
+int characterMap_getNearestIndex(characterMap_t *characterMap, const char *character, uint8_t fromIndex)
+{
+    int index = characterMap_getIndex(characterMap, character);
+    if (index < 0 || !characterMap->hasDuplicates) {
+        return index; // a unique character is only on one flap.
+    }
+    for (size_t n = 0; n < characterMap->size; n++) { // the wheel only turns forward.
+        size_t i = (fromIndex + n) % characterMap->size;
+        if (!memcmp(&characterMap->character[4 * i], character, 4)) {
+            return i;
+        }
+    }
+    return index;
+}
+
+int characterMap_getIndex(characterMap_t *characterMap, const char *character)
+{
+    if (!characterMap || !characterMap->lookup) {
+        return -1;
+    }
+    uint32_t slot = characterMap_hash(character) & characterMap->lookupMask;
+    while (characterMap->lookup[slot]) {
+        uint8_t index = characterMap->lookup[slot] - 1;
+        if (!memcmp(&characterMap->character[4 * index], character, 4)) {
+            return index;
+        }
+        slot = (slot + 1) & characterMap->lookupMask;
+    }
+    return -1;
+}
+
+size_t utf8_getCharacter(const char *str, char *character)
+{
+    size_t len = 1;
+    uint8_t lead = (uint8_t)str[0];
+    memset(character, 0, 4);
+    if (!lead) {
+        return 0;
+    } else if ((lead & 0xE0) == 0xC0) {
+        len = 2;
+    } else if ((lead & 0xF0) == 0xE0) {
+        len = 3;
+    } else if ((lead & 0xF8) == 0xF0) {
+        len = 4;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (!str[i]) {
+            return i;
+        }
+        character[i] = str[i];
+    }
+    return len;
+}
+
 // Modules
 
 void module_delete(module_t *module)
@@ -245,13 +1217,25 @@ void module_delete(module_t *module)
     }
 }
 
+static void module_setPropertyHash(module_t *module, moduleProperty_t property, uint32_t hash)
+{
+    if (module->propertyHash[property] != hash) {
+        module->changedProperties |= (1 << property);
+    }
+    module->propertyHash[property] = hash;
+}
+
 bool module_getColumnEnd(module_t *module)
 {
     return module->colEnd;
 }
 void module_setColumnEnd(module_t *module, bool colEnd)
 {
+    if (module->colEnd != colEnd) {
+        ctx.controller->display.geometryValid = false;
+    }
     module->colEnd = colEnd;
+    module_setPropertyHash(module, columnEnd_property, colEnd);
 }
 
 char *module_getCharacter(module_t *module)
@@ -271,20 +1255,16 @@ void module_setCharacter(module_t *module, char *character)
     char buf[4] = {0};
     strncpy(buf, character, 4);
     // check if the char is in the characterMap.
-    for (int i = 0; i < module->characterMap->size; i++) {
-        if (module->characterMap->character[4 * i + 0] == buf[0] &&
-            module->characterMap->character[4 * i + 1] == buf[1] &&
-            module->characterMap->character[4 * i + 2] == buf[2] &&
-            module->characterMap->character[4 * i + 3] == buf[3]) {
-            module_setCharacterIndex(module, i);
-            return;
-        }
+    int index = characterMap_getNearestIndex(module->characterMap, buf, module->characterIndex);
+    if (index >= 0) {
+        module_setCharacterIndex(module, index);
     }
 }
 
 void module_setCharacterIndex(module_t *module, uint8_t characterIndex)
 {
     module->characterIndex = characterIndex;
+    module_setPropertyHash(module, character_property, characterIndex);
     module->updatableProperties |= (1 << character_property);
 }
 
@@ -306,17 +1286,25 @@ characterMap_t *module_getCharacterMap(module_t *module)
 
 void module_setCharacterMap(module_t *module, characterMap_t *characterMap)
 {
-    for (int i = 0; i < display_getSize(); i++) {
-        if (characterMap_isEqual(display_getModule(i)->characterMap, characterMap)) {
-            characterMap_delete(characterMap);                 // delete "new" characterMap
-            characterMap = display_getModule(i)->characterMap; // refer to existing characterMap
+    display_lock(); // characterMaps are shared between the modules of both frames.
+    for (int i = 0; i < 2 * display_getSize(); i++) {
+        module_t *other = i < display_getSize() ? display_getModule(i) : display_getBackModule(i - display_getSize());
+        if (characterMap_isEqual(other->characterMap, characterMap)) {
+            characterMap_delete(characterMap);   // delete "new" characterMap
+            characterMap = other->characterMap; // refer to existing characterMap
             characterMap->reffCnt++;
             break;
         }
     }
+    if (characterMap && !characterMap->lookup) {
+        characterMap_buildLookup(characterMap); // interned for the first time.
+    }
     characterMap_delete(module->characterMap);
     module->characterMap = characterMap;
+    module_setPropertyHash(module, characterMapSize_property, characterMap ? characterMap->size : 0);
+    module_setPropertyHash(module, characterMap_property, characterMap ? characterMap->hash : 0);
     module->updatableProperties |= (1 << characterMap_property);
+    display_unlock();
 }
 
 uint8_t module_getOffset(module_t *module)
@@ -326,6 +1314,7 @@ uint8_t module_getOffset(module_t *module)
 void module_setOffset(module_t *module, uint8_t offset)
 {
     module->calibration.offset = offset;
+    module_setPropertyHash(module, offset_property, offset);
     module->updatableProperties |= (1 << offset_property);
 }
 
@@ -336,6 +1325,7 @@ uint8_t module_getVtrim(module_t *module)
 void module_setVtrim(module_t *module, uint8_t vtrim)
 {
     module->calibration.vtrim = vtrim;
+    module_setPropertyHash(module, vtrim_property, vtrim);
     module->updatableProperties |= (1 << vtrim_property);
 }
 
@@ -346,5 +1336,90 @@ uint8_t module_getBaseSpeed(module_t *module)
 void module_setBaseSpeed(module_t *module, uint8_t baseSpeed)
 {
     module->baseSpeed = baseSpeed;
+    module_setPropertyHash(module, baseSpeed_property, baseSpeed);
     module->updatableProperties |= (1 << baseSpeed_property);
+}
+
+uint16_t module_getCharacterDelay(module_t *module)
+{
+    return module->characterDelay;
+}
+void module_setCharacterDelay(module_t *module, uint16_t characterDelay)
+{
+    module->characterDelay = characterDelay;
+    module_setPropertyHash(module, characterDelay_property, characterDelay);
+    module->updatableProperties |= (1 << characterDelay_property);
+}
+
+uint16_t module_getConfigChecksum(module_t *module)
+{
+    return module->configChecksum;
+}
+void module_setConfigChecksum(module_t *module, uint16_t configChecksum)
+{
+    module->configChecksum = configChecksum; // read only, the module calculates it.
+    module_setPropertyHash(module, configChecksum_property, configChecksum);
+}
+
+uint16_t module_getFlapPeriod(module_t *module)
+{
+    return module->flapPeriod;
+}
+void module_setFlapPeriod(module_t *module, uint16_t flapPeriod)
+{
+    module->flapPeriod = flapPeriod; // read only, the module measures it.
+    module_setPropertyHash(module, flapPeriod_property, flapPeriod);
+}
+
+uint32_t module_getEtaMs(module_t *module)
+{
+    if (module->fault & fault_stall) {
+        return 0; // the module gave up on its character.
+    }
+    TickType_t remaining = module->arrivalTick - xTaskGetTickCount();
+    return remaining < portMAX_DELAY / 2 ? remaining * portTICK_PERIOD_MS : 0; // the arrival is in the past.
+}
+
+moduleCommand_t module_getCommand(module_t *module)
+{
+    return module->command;
+}
+void module_setCommand(module_t *module, moduleCommand_t command)
+{
+    module->command = command;
+    module_setPropertyHash(module, command_property, command);
+    module->updatableProperties |= (1 << command_property);
+}
+
+const encoderStats_t *module_getEncoderStats(module_t *module)
+{
+    return &module->encoderStats;
+}
+void module_setEncoderStats(module_t *module, const encoderStats_t *encoderStats)
+{
+    module->encoderStats = *encoderStats; // read only, the module records it.
+    module_setPropertyHash(module, encoderStats_property,
+                           model_snapshotHash((const uint8_t *)encoderStats, sizeof(encoderStats_t)));
+}
+
+const uint16_t *module_getIrLimits(module_t *module)
+{
+    return module->irLimits;
+}
+void module_setIrLimits(module_t *module, const uint16_t *irLimits)
+{
+    memmove(module->irLimits, irLimits, sizeof(module->irLimits));
+    module_setPropertyHash(module, irLimits_property,
+                           model_snapshotHash((const uint8_t *)module->irLimits, sizeof(module->irLimits)));
+    module->updatableProperties |= (1 << irLimits_property);
+}
+
+uint8_t module_getFault(module_t *module)
+{
+    return module->fault;
+}
+void module_setFault(module_t *module, uint8_t fault)
+{
+    module->fault = fault; // read only, the module raises it.
+    module_setPropertyHash(module, fault_property, fault);
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include <string.h>
 
 #include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
 
 #include "driver/gpio.h"
@@ -26,25 +27,69 @@ typedef struct {
     uint8_t size;
     char *character; // UTF-8
     int reffCnt;
+    uint8_t *lookup;     // open addressed hash table of character index + 1, 0 marks an empty slot.
+    uint16_t lookupMask; // number of lookup slots - 1, the number of slots is a power of 2.
+    uint32_t hash;       // content hash of the characters, equal maps have equal hashes.
+    bool hasDuplicates;  // a character is on more than one flap, the lookup holds its first index.
 } characterMap_t;
 
+typedef enum {
+    transition_none,
+    transition_wave,    // the columns start one after another from left to right.
+    transition_sweep,   // the modules of every column start one after another from top to bottom.
+    transition_cascade, // the modules start in random order.
+} transitionType_t;
+
+// A transition staggers the moment the modules start to turn towards a new character. The delay of each module follows
+// from its position, the delays are sent in the same pass as the characters.
+typedef struct {
+    transitionType_t type;
+    uint16_t durationMs; // time between the first and the last module starting.
+} Transition_t;
+
+#define MODULE_IR_SENSOR_CNT 6 // IR sensors of the encoder of a module.
+
+// Statistics a module records while it turns its calibration revolution.
+typedef struct {
+    bool calibrating;      // the module is still turning.
+    uint8_t positionsSeen; // number of different encoder codes decoded with the current irLimits.
+    uint16_t irMin[MODULE_IR_SENSOR_CNT];
+    uint16_t irMax[MODULE_IR_SENSOR_CNT];
+} encoderStats_t;
+
 typedef struct {
     uint8_t characterIndex; // index of the current character in the characterMap
     Calibration_t calibration;
     characterMap_t *characterMap;
     uint8_t baseSpeed;
+    uint16_t characterDelay; // ms before the module applies the character written in the same pass.
+    uint16_t configChecksum; // checksum of the module over the properties kept in the snapshot.
+    uint16_t flapPeriod;     // average ms per flap measured by the module, 0 until it has turned.
+    TickType_t arrivalTick;  // predicted tick at which the module shows its character.
+    moduleCommand_t command;
+    encoderStats_t encoderStats;
+    uint16_t irLimits[MODULE_IR_SENSOR_CNT]; // ADC threshold of each IR sensor of the encoder.
+    uint8_t fault;                           // moduleFault_t flags, a faulted module is not waited for.
     char *firmwareVersion;
     bool colEnd;
     uint64_t updatableProperties;
+    uint32_t propertyHash[end_of_properties]; // content hash of each property, kept up to date by the setters.
+    uint64_t changedProperties; // properties whose content hash changed since the bits were last cleared.
 } module_t;
 
 typedef struct {
-    // size_t width;
-    // size_t height;
+    size_t width;  // number of columns, a column ends at a module with colEnd set.
+    size_t height; // number of modules in the longest column.
+    int16_t *moduleAt; // index of the module at column x, row y in element x * height + y, -1 below a short column.
+    bool geometryValid;
     size_t size;
-    module_t *module;
-    // Transition_t transition;
+    module_t *module;     // front frame, owned by the model and uart tasks.
+    module_t *backModule; // back frame, written by the http handlers and published by display_swapFrames.
+    SemaphoreHandle_t frameLock;
+    Transition_t transition; // applied to the characters of the next pass.
     uint64_t requestedProperties;
+    uint64_t cachedProperties;                      // properties of which the front frame holds a value read from the chain.
+    TickType_t propertyReadTick[end_of_properties]; // tick of the last successful read of each property.
 } Display_t;
 
 typedef struct {
@@ -53,11 +98,75 @@ typedef struct {
     char *firmwareVersion;
 } controller_t;
 
+// Requests arriving within this window after the first one are merged into a single model pass.
+#ifndef MODEL_COALESCE_WINDOW_MS
+#define MODEL_COALESCE_WINDOW_MS 50
+#endif
+#define MODEL_MAX_WAITERS 8
+
+// The topology, characterMaps and calibration of the modules are kept in a snapshot in NVS. After a reboot the snapshot
+// is restored when the configChecksum of every module still matches, which skips the discovery of the chain.
+#define MODEL_SNAPSHOT_KEY     "snapshot"
+#define MODEL_SNAPSHOT_VERSION 1
+#define MODEL_SNAPSHOT_PROPERTIES                                                                                      \
+    ((1 << columnEnd_property) | (1 << characterMapSize_property) | (1 << characterMap_property) |                    \
+     (1 << offset_property) | (1 << vtrim_property) | (1 << baseSpeed_property))
+
+// The arrival of a module at its character is predicted from the distance to turn and the flapPeriod of the module.
+// Modules that have not reported a flapPeriod yet use the default. A character is applied by the module about one
+// command period after the pass started.
+#ifndef MODEL_DEFAULT_FLAP_PERIOD_MS
+#define MODEL_DEFAULT_FLAP_PERIOD_MS 100
+#endif
+#define MODEL_WRITE_LATENCY_MS MAX_COMMAND_PERIOD_MS
+
+// Time a property read from the chain is served from the cache. Static properties are only read again after the
+// display has changed size or a refresh is forced.
+#define MODEL_TTL_STATIC       portMAX_DELAY
+#ifndef MODEL_TTL_CHARACTER_MS
+#define MODEL_TTL_CHARACTER_MS 1000
+#endif
+#ifndef MODEL_TTL_CONFIG_MS
+#define MODEL_TTL_CONFIG_MS 60000
+#endif
+
 typedef struct {
     TaskHandle_t task;
     controller_t *controller;
+    TaskHandle_t waiters[MODEL_MAX_WAITERS]; // tasks to notify when the current model pass has finished.
+    size_t waiterCnt;
+    SemaphoreHandle_t waiterLock;
+    SemaphoreHandle_t transactionDone; // given once for every finished chain transaction.
+    uint8_t *snapshot; // snapshot loaded at boot, until it has been validated against the chain.
+    size_t snapshotLen;
+    uint32_t snapshotHash; // hash of the stored snapshot without its checksums.
 } OpenFlapModel_ctx_t;
 
+typedef enum {
+    display_alignLeft,
+    display_alignCenter,
+    display_alignRight,
+} display_align_t;
+
+typedef enum {
+    display_wrapWord,      // lines break at the last space that fits, longer words are split.
+    display_wrapCharacter, // lines break after the last column.
+    display_wrapNone,      // the part of a line that does not fit is dropped.
+} display_wrap_t;
+
+#define DISPLAY_TEXT_MAX_ALIGN 16 // rows of a text with an alignment of their own.
+// properties a text layout depends on.
+#define DISPLAY_TEXT_PROPERTIES                                                                                        \
+    ((1 << columnEnd_property) | (1 << characterMapSize_property) | (1 << characterMap_property))
+
+typedef struct {
+    display_wrap_t wrap;
+    size_t row;  // row of the display the text starts at.
+    bool clear;  // blank the rows that are not covered by the text.
+    size_t alignCnt;
+    display_align_t align[DISPLAY_TEXT_MAX_ALIGN]; // alignment of each row of the text, the last holds for the rest.
+} display_textLayout_t;
+
 typedef enum {
     fromNothing,
     fromHttp,
@@ -68,23 +177,45 @@ typedef enum {
 TaskHandle_t modelTask();
 
 void flap_model_init();
-void model_preformUart();
+bool model_preformUart();
+void model_requestUpdate(); // starts a model pass without waiting for it.
 
 controller_t *controller_new();
 void controller_delete(controller_t *controller);
 
 void display_requestModuleProperty(moduleProperty_t property);
 uint64_t display_getRequestModuleProperties();
+uint64_t display_getStaleModuleProperties(uint64_t properties); // returns the properties that must be read again.
+void display_invalidateModuleProperties(uint64_t properties);
+bool display_refreshModuleProperties(uint64_t properties); // reads the stale properties, false if the chain failed.
 
 void display_setPowered(bool powered);
 bool display_getPowered();
 module_t *display_getModule(size_t i);
+module_t *display_getBackModule(size_t i);
+void display_lock();
+void display_unlock();
+void display_swapFrames();
+void display_syncBackFrame(uint64_t properties);
+void display_applyTransition(); // sets the characterDelay of the modules with a new character.
+uint32_t display_getEtaMs(); // time until every module shows its character.
 // bool display_setDimensions(size_t width, size_t height);
 bool display_setSize(size_t size);
-bool display_setMessage(Display_t *display, char *message);
+// Lays out UTF-8 text, lines end at '\n' and text beyond the last row is dropped. Lower case letters fall back to upper
+// case. Returns false if a character is not in the character map of its module, it shows a space. indices receives the
+// character index of each module, -1 for the modules outside of the text.
+bool display_layoutMessage(const char *message, const display_textLayout_t *layout, int16_t *indices);
+void display_setCharacterIndices(const int16_t *indices, size_t cnt); // writes the indices >= 0 into the back frame.
+bool display_setMessage(const char *message, const display_textLayout_t *layout); // lays out text on the back frame.
+bool display_parseAlign(const char *names, display_textLayout_t *layout); // comma separated left, center or right.
+bool display_parseWrap(const char *name, display_textLayout_t *layout);   // word, char or none.
+void display_setTransition(const Transition_t *transition);
+bool display_parseTransition(const char *name, Transition_t *transition); // none, wave, sweep or cascade.
 size_t display_getWidth();
 size_t display_getHeight();
+int display_getModuleIndex(size_t column, size_t row); // returns -1 if there is no module at this position.
 size_t display_getSize();
+bool display_modulePropertiesAreEqual(moduleProperty_t property);
 
 characterMap_t *characterMap_new();
 void characterMap_delete(characterMap_t *characterMap);
@@ -92,6 +223,12 @@ void characterMap_getCharacter(characterMap_t *characterMap, size_t index,
                                char *character); // character must be an array of 5 bytes. This array will be populated
                                                  // with a null terminated UTF-8 encoded character.
 bool characterMap_isEqual(characterMap_t *a, characterMap_t *b);
+bool characterMap_buildLookup(characterMap_t *characterMap);
+int characterMap_getIndex(characterMap_t *characterMap, const char *character); // returns -1 if not in the map.
+// Returns the index of the character that is the fewest flaps ahead of fromIndex, for maps holding duplicates.
+int characterMap_getNearestIndex(characterMap_t *characterMap, const char *character, uint8_t fromIndex);
+size_t utf8_getCharacter(const char *str, char *character); // character must be an array of 4 bytes. Returns the
+                                                            // number of bytes consumed from str.
 
 void module_delete(module_t *module);
 
@@ -116,4 +253,26 @@ void module_setVtrim(module_t *module, uint8_t vtrim);
 
 uint8_t module_getBaseSpeed(module_t *module);
 void module_setBaseSpeed(module_t *module, uint8_t baseSpeed);
+
+uint16_t module_getCharacterDelay(module_t *module);
+void module_setCharacterDelay(module_t *module, uint16_t characterDelay);
+
+uint16_t module_getConfigChecksum(module_t *module);
+void module_setConfigChecksum(module_t *module, uint16_t configChecksum);
+
+uint16_t module_getFlapPeriod(module_t *module);
+void module_setFlapPeriod(module_t *module, uint16_t flapPeriod);
+uint32_t module_getEtaMs(module_t *module); // time until the module shows its character.
+
+moduleCommand_t module_getCommand(module_t *module);
+void module_setCommand(module_t *module, moduleCommand_t command);
+
+const encoderStats_t *module_getEncoderStats(module_t *module);
+void module_setEncoderStats(module_t *module, const encoderStats_t *encoderStats);
+
+const uint16_t *module_getIrLimits(module_t *module); // array of MODULE_IR_SENSOR_CNT thresholds.
+void module_setIrLimits(module_t *module, const uint16_t *irLimits);
+
+uint8_t module_getFault(module_t *module);
+void module_setFault(module_t *module, uint8_t fault);
 #endif
\ No newline at end of file
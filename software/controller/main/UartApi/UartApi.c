@@ -70,13 +70,76 @@ void baseSpeed_deserialize(char *data, module_t *module)
     module_setBaseSpeed(module, data[0]);
 }
 
+void characterDelay_serialize(char *data, module_t *module)
+{
+    uint16_t characterDelay = module_getCharacterDelay(module);
+    data[0] = characterDelay & 0xff;
+    data[1] = characterDelay >> 8;
+}
+
+void configChecksum_deserialize(char *data, module_t *module)
+{
+    module_setConfigChecksum(module, (uint8_t)data[0] | (uint8_t)data[1] << 8);
+}
+
+void flapPeriod_deserialize(char *data, module_t *module)
+{
+    module_setFlapPeriod(module, (uint8_t)data[0] | (uint8_t)data[1] << 8);
+}
+
+void command_serialize(char *data, module_t *module)
+{
+    data[0] = module_getCommand(module);
+}
+
+void encoderStats_deserialize(char *data, module_t *module)
+{
+    encoderStats_t encoderStats = {.calibrating = data[0], .positionsSeen = data[1]};
+    for (int i = 0; i < MODULE_IR_SENSOR_CNT; i++) {
+        encoderStats.irMin[i] = (uint8_t)data[2 + 2 * i] | (uint8_t)data[3 + 2 * i] << 8;
+        encoderStats.irMax[i] = (uint8_t)data[2 + 2 * MODULE_IR_SENSOR_CNT + 2 * i] |
+                                (uint8_t)data[3 + 2 * MODULE_IR_SENSOR_CNT + 2 * i] << 8;
+    }
+    module_setEncoderStats(module, &encoderStats);
+}
+
+void irLimits_serialize(char *data, module_t *module)
+{
+    const uint16_t *irLimits = module_getIrLimits(module);
+    for (int i = 0; i < MODULE_IR_SENSOR_CNT; i++) {
+        data[2 * i] = irLimits[i] & 0xff;
+        data[2 * i + 1] = irLimits[i] >> 8;
+    }
+}
+
+void irLimits_deserialize(char *data, module_t *module)
+{
+    uint16_t irLimits[MODULE_IR_SENSOR_CNT];
+    for (int i = 0; i < MODULE_IR_SENSOR_CNT; i++) {
+        irLimits[i] = (uint8_t)data[2 * i] | (uint8_t)data[2 * i + 1] << 8;
+    }
+    module_setIrLimits(module, irLimits);
+}
+
+void fault_deserialize(char *data, module_t *module)
+{
+    module_setFault(module, data[0]);
+}
+
 void uart_api_init()
 {
+    uart_addModulePropertyHandler(command_property, NULL, command_serialize);
     uart_addModulePropertyHandler(columnEnd_property, columnEnd_deserialize, NULL);
+    uart_addModulePropertyHandler(characterDelay_property, NULL, characterDelay_serialize);
     uart_addModulePropertyHandler(character_property, character_deserialize, character_serialize);
     uart_addModulePropertyHandler(characterMapSize_property, characterMapSize_deserialize, NULL);
     uart_addModulePropertyHandler(characterMap_property, characterMap_deserialize, characterMap_serialize);
     uart_addModulePropertyHandler(offset_property, offset_deserialize, offset_serialize);
     uart_addModulePropertyHandler(vtrim_property, vtrim_deserialize, vtrim_serialize);
     uart_addModulePropertyHandler(baseSpeed_property, baseSpeed_deserialize, baseSpeed_serialize);
+    uart_addModulePropertyHandler(configChecksum_property, configChecksum_deserialize, NULL);
+    uart_addModulePropertyHandler(flapPeriod_property, flapPeriod_deserialize, NULL);
+    uart_addModulePropertyHandler(encoderStats_property, encoderStats_deserialize, NULL);
+    uart_addModulePropertyHandler(irLimits_property, irLimits_deserialize, irLimits_serialize);
+    uart_addModulePropertyHandler(fault_property, fault_deserialize, NULL);
 }
\ No newline at end of file
@@ -0,0 +1,233 @@
+#include "flap_calibration.h"
+
+static const char *TAG = "[CALIBRATION]";
+
+static TimerHandle_t abandonTimer; // ends a calibration whose offsets are never set.
+static SemaphoreHandle_t lock;     // guards state.
+static calibration_state_t state;
+
+static void calibration_end(void)
+{
+    xTimerStop(abandonTimer, portMAX_DELAY);
+    xSemaphoreTake(lock, portMAX_DELAY);
+    state = calibration_idle;
+    xSemaphoreGive(lock);
+    playlist_resume();
+}
+
+static void calibration_abandon(TimerHandle_t timer)
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool abandoned = state == calibration_awaitingOffsets;
+    if (abandoned) {
+        state = calibration_idle;
+    }
+    xSemaphoreGive(lock);
+    if (abandoned) {
+        ESP_LOGW(TAG, "The offsets were not set, the playlist continues");
+        playlist_resume();
+    }
+}
+
+void flap_calibration_init(void)
+{
+    lock = xSemaphoreCreateMutex();
+    state = calibration_idle;
+    abandonTimer = xTimerCreate("Calibration", pdMS_TO_TICKS(CALIBRATION_OFFSET_TIMEOUT_MS), pdFALSE, NULL,
+                                calibration_abandon);
+}
+
+bool calibration_isActive(void)
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool active = state != calibration_idle;
+    xSemaphoreGive(lock);
+    return active;
+}
+
+// Starts the revolution on every module and returns the time it is predicted to take.
+static TickType_t calibration_start(size_t *size)
+{
+    uint32_t period = MODEL_DEFAULT_FLAP_PERIOD_MS;
+    uint32_t flaps = 0;
+    display_lock();
+    *size = display_getSize();
+    for (size_t i = 0; i < *size; i++) {
+        module_t *backModule = display_getBackModule(i);
+        module_setCommand(backModule, calibrate_command);
+        period = module_getFlapPeriod(backModule) > period ? module_getFlapPeriod(backModule) : period;
+        flaps = module_getCharacterMapSize(backModule) > flaps ? module_getCharacterMapSize(backModule) : flaps;
+    }
+    display_unlock();
+    return pdMS_TO_TICKS(flaps * period + CALIBRATION_MARGIN_MS);
+}
+
+// Reads the encoder statistics until no module is turning anymore.
+static bool calibration_awaitRevolution(TickType_t startTick)
+{
+    while (true) {
+        // a module that stalls ends its revolution, the fault must be read in the same pass as its statistics.
+        display_invalidateModuleProperties(1 << fault_property);
+        if (!display_refreshModuleProperties((1 << encoderStats_property) | (1 << fault_property))) {
+            return false;
+        }
+        bool calibrating = false;
+        display_lock();
+        for (size_t i = 0; i < display_getSize(); i++) {
+            calibrating |= module_getEncoderStats(display_getBackModule(i))->calibrating;
+        }
+        display_unlock();
+        if (!calibrating) {
+            return true;
+        }
+        if (xTaskGetTickCount() - startTick > pdMS_TO_TICKS(CALIBRATION_TIMEOUT_MS)) {
+            ESP_LOGW(TAG, "Modules are still calibrating, using the statistics recorded so far");
+            return true;
+        }
+        vTaskDelay(pdMS_TO_TICKS(CALIBRATION_POLL_MS));
+    }
+}
+
+static void calibration_evaluate(module_t *module, calibration_result_t *result)
+{
+    const encoderStats_t *stats = module_getEncoderStats(module);
+    // a module that stalled did not complete the revolution, so its statistics do not cover every position.
+    result->valid = !(module_getFault(module) & fault_stall);
+    result->positionsSeen = stats->positionsSeen;
+    for (int i = 0; i < MODULE_IR_SENSOR_CNT; i++) {
+        result->irMin[i] = stats->irMin[i];
+        result->irMax[i] = stats->irMax[i];
+        result->irLimits[i] = module_getIrLimits(module)[i];
+        result->valid &= stats->irMax[i] >= stats->irMin[i] + CALIBRATION_MIN_CONTRAST;
+    }
+    if (result->valid) {
+        for (int i = 0; i < MODULE_IR_SENSOR_CNT; i++) {
+            result->irLimits[i] = (stats->irMin[i] + stats->irMax[i]) / 2;
+        }
+        module_setIrLimits(module, result->irLimits);
+    }
+}
+
+// Runs the revolution and turns every module to the first character of its map.
+static bool calibration_revolve(calibration_result_t **results, size_t *cnt)
+{
+    // the current limits are reported for the modules that can not be calibrated.
+    if (!display_refreshModuleProperties(DISPLAY_TEXT_PROPERTIES | (1 << flapPeriod_property) |
+                                         (1 << irLimits_property))) {
+        return false;
+    }
+    size_t size;
+    TickType_t revolution = calibration_start(&size);
+    if (!model_preformUart()) {
+        return false;
+    }
+    TickType_t startTick = xTaskGetTickCount();
+    ESP_LOGI(TAG, "Calibrating %d modules, expected to take %lu ms", size,
+             (unsigned long)(revolution * portTICK_PERIOD_MS));
+    vTaskDelay(revolution);
+    if (!calibration_awaitRevolution(startTick)) {
+        return false;
+    }
+
+    calibration_result_t *result = calloc(size + 1, sizeof(calibration_result_t));
+    if (!result) {
+        ESP_LOGE(TAG, "Failed to allocate memory for the calibration results.");
+        return false;
+    }
+    display_lock();
+    if (display_getSize() != size) {
+        display_unlock();
+        ESP_LOGE(TAG, "The display changed size during the calibration.");
+        free(result);
+        return false;
+    }
+    for (size_t i = 0; i < size; i++) {
+        calibration_evaluate(display_getBackModule(i), &result[i]);
+        if (!result[i].valid) {
+            ESP_LOGW(TAG, "Module %d stalled or has too little contrast to calibrate", i);
+        }
+    }
+    display_unlock();
+    // irLimits follows character in property order, so the limits get a pass of their own before the modules turn to
+    // the first character. The offsets are read from the wall afterwards.
+    if (!model_preformUart()) {
+        free(result);
+        return false;
+    }
+    display_lock();
+    for (size_t i = 0; i < size && i < display_getSize(); i++) {
+        module_t *backModule = display_getBackModule(i);
+        module_setVtrim(backModule, 0);
+        module_setCharacterIndex(backModule, 0);
+    }
+    display_unlock();
+    if (!model_preformUart()) {
+        free(result);
+        return false;
+    }
+    *results = result;
+    *cnt = size;
+    return true;
+}
+
+calibration_status_t calibration_run(calibration_result_t **results, size_t *cnt)
+{
+    *results = NULL;
+    *cnt = 0;
+    // a run may follow a run whose offsets were not set, but two runs must not turn the modules at once.
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (state == calibration_running) {
+        xSemaphoreGive(lock);
+        return calibration_busy;
+    }
+    state = calibration_running;
+    xSemaphoreGive(lock);
+    xTimerStop(abandonTimer, portMAX_DELAY);
+    playlist_pause();
+    if (!calibration_revolve(results, cnt)) {
+        calibration_end();
+        return calibration_chainFailed;
+    }
+    // the modules stay on the first character of their map until the offsets are set.
+    xSemaphoreTake(lock, portMAX_DELAY);
+    state = calibration_awaitingOffsets;
+    xSemaphoreGive(lock);
+    xTimerReset(abandonTimer, portMAX_DELAY);
+    return calibration_done;
+}
+
+bool calibration_setOffsets(const char *shown, bool *valid)
+{
+    *valid = true;
+    if (!display_refreshModuleProperties(DISPLAY_TEXT_PROPERTIES | (1 << offset_property))) {
+        return false;
+    }
+    display_lock();
+    for (size_t i = 0; i < display_getSize() && *shown; i++) {
+        char character[4];
+        shown += utf8_getCharacter(shown, character);
+        module_t *backModule = display_getBackModule(i);
+        uint8_t size = module_getCharacterMapSize(backModule);
+        int index = size ? characterMap_getIndex(module_getCharacterMap(backModule), character) : -1;
+        if (index < 0) {
+            ESP_LOGW(TAG, "Module %d shows a character that is not in its map", i);
+            *valid = false;
+            continue;
+        }
+        // the module shows the character at index when it is set to 0, so its encoder is index characters behind.
+        module_setOffset(backModule, (module_getOffset(backModule) + index) % size);
+        module_setCharacterIndex(backModule, 0);
+    }
+    display_unlock();
+    if (!model_preformUart()) {
+        return false;
+    }
+    // an incomplete set of offsets can be posted again, the modules that were corrected then show index 0.
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool awaitingOffsets = state == calibration_awaitingOffsets;
+    xSemaphoreGive(lock);
+    if (*valid && awaitingOffsets) {
+        calibration_end();
+    }
+    return true;
+}
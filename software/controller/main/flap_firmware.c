@@ -32,13 +32,15 @@ void flap_controller_firmware_update(char *data, size_t data_len, size_t data_of
         update_handle = 0;
         update_partition = esp_ota_get_next_update_partition(NULL);
         assert(update_partition != NULL);
-        err = esp_ota_begin(update_partition, total_data_len, &update_handle);
+        // the image is erased while it is written when its size is not known yet.
+        err = esp_ota_begin(update_partition, total_data_len ? total_data_len : OTA_WITH_SEQUENTIAL_WRITES,
+                            &update_handle);
         if (err != ESP_OK) {
             ESP_LOGE(TAG, "esp_ota_begin failed (%s)", esp_err_to_name(err));
         }
     }
     ESP_LOGI(TAG, "OTA: writing %d %d/%d bytes", data_len, data_offset, total_data_len);
-    err = esp_ota_write(update_handle, data, data_len);
+    err = data_len ? esp_ota_write(update_handle, data, data_len) : ESP_OK;
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Error: esp_ota_write failed (%s)!", esp_err_to_name(err));
     }
@@ -1,139 +1,200 @@
 #define DO_GENERATE_PROPERTY_NAMES
 #include "flap_http_server.h"
 
-// #define MAX_WS_CONNECTIONS 3
 static const char *TAG = "[HTTP]";
 TaskHandle_t task;
 
 static httpd_handle_t server = NULL;
-http_modulePropertyHandler_t http_modulePropertyHandlers[end_of_properties] = {0};
+static int wsClients[MAX_WS_CONNECTIONS]; // socket of each connected websocket client, -1 marks a free slot.
+static SemaphoreHandle_t wsLock;
 
+typedef esp_err_t (*http_requestHandler_t)(httpd_req_t *req);
 typedef struct {
-    size_t data_len;
-    size_t data_offset;
-    size_t total_data_len;
-    char data[CMD_COMM_BUF_LEN];
-} controller_queue_data_t;
+    httpd_req_t *req;
+    http_requestHandler_t handler;
+} http_asyncRequest_t;
+static QueueHandle_t asyncRequestQueue;
+static TaskHandle_t asyncWorkers[HTTP_ASYNC_WORKER_CNT];
+
+http_modulePropertyHandler_t http_modulePropertyHandlers[end_of_properties] = {0};
 
-static int httpd_req_recv_blocking(httpd_req_t *req, char *data, int len)
+static bool http_isAsyncWorker()
 {
-    int total_recv = 0, curr_recv = 0;
-    do {
-        curr_recv = httpd_req_recv(req, data + total_recv, len - total_recv);
-        if (curr_recv < 0) {
-            ESP_LOGE(TAG, "An error occured while reading data");
-            return -curr_recv;
-        } else if (curr_recv == 0) {
-            ESP_LOGI(TAG, "There is tempoarily no more data.");
-            taskYIELD();
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (int i = 0; i < HTTP_ASYNC_WORKER_CNT; i++) {
+        if (asyncWorkers[i] == self) {
+            return true;
         }
-        total_recv += curr_recv;
-    } while (total_recv < len);
-    return total_recv;
+    }
+    return false;
 }
 
-static esp_err_t index_page_get_handler(httpd_req_t *req)
+// Hands a request over to a worker task, so the httpd task can serve other clients while the worker waits for the
+// chain.
+static esp_err_t http_queueAsync(httpd_req_t *req, http_requestHandler_t handler)
 {
-    httpd_resp_set_type(req, "text/html");
-    httpd_resp_send(req, (const char *)index_start, index_end - index_start);
+    http_asyncRequest_t request = {.req = NULL, .handler = handler};
+    if (httpd_req_async_handler_begin(req, &request.req) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start asynchronous request");
+        return ESP_FAIL;
+    }
+    if (xQueueSend(asyncRequestQueue, &request, 0) != pdTRUE) {
+        ESP_LOGE(TAG, "All http workers are busy");
+        httpd_resp_set_status(request.req, "503 Service Unavailable");
+        httpd_resp_send(request.req, NULL, 0);
+        httpd_req_async_handler_complete(request.req);
+    }
+    return ESP_OK;
+}
+
+static void http_asyncWorkerTask(void *arg)
+{
+    http_asyncRequest_t request;
+    while (1) {
+        if (xQueueReceive(asyncRequestQueue, &request, portMAX_DELAY) == pdTRUE) {
+            ESP_LOGI(TAG, "Worker %d serves %s", (int)(intptr_t)arg, request.req->uri);
+            request.handler(request.req);
+            httpd_req_async_handler_complete(request.req);
+        }
+    }
+}
+
+// A client without an Accept-Encoding header accepts any encoding.
+static bool http_acceptsGzip(httpd_req_t *req)
+{
+    char acceptEncoding[128];
+    if (!httpd_req_get_hdr_value_len(req, "Accept-Encoding")) {
+        return true;
+    }
+    // a value that does not fit is truncated, gzip is listed among the first encodings by every browser.
+    httpd_req_get_hdr_value_str(req, "Accept-Encoding", acceptEncoding, sizeof(acceptEncoding));
+    return strstr(acceptEncoding, "gzip") != NULL;
+}
+
+typedef struct {
+    const char *type;
+    const uint8_t *gzStart;
+    const uint8_t *gzEnd;
+    const uint8_t *start; // uncompressed, for clients that do not accept gzip.
+    const uint8_t *end;
+    const char *etag;
+    const char *cacheControl;
+} http_asset_t;
+
+// Sends an asset gzip compressed when the client accepts it, or 304 when the client has cached the asset with the same
+// ETag. Both encodings have the same content, so they share the ETag.
+static esp_err_t http_sendAsset(httpd_req_t *req, const http_asset_t *asset)
+{
+    char ifNoneMatch[24];
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    httpd_resp_set_hdr(req, "ETag", asset->etag);
+    httpd_resp_set_hdr(req, "Cache-Control", asset->cacheControl);
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", ifNoneMatch, sizeof(ifNoneMatch)) == ESP_OK &&
+        strcmp(ifNoneMatch, asset->etag) == 0) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
+    httpd_resp_set_type(req, asset->type);
+    if (http_acceptsGzip(req)) {
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+        httpd_resp_send(req, (const char *)asset->gzStart, asset->gzEnd - asset->gzStart);
+    } else {
+        httpd_resp_send(req, (const char *)asset->start, asset->end - asset->start);
+    }
     return ESP_OK;
 }
+
+static esp_err_t index_page_get_handler(httpd_req_t *req)
+{
+    // the page is revalidated on every load, so it always refers to the current versions of the other assets.
+    static const http_asset_t asset = {"text/html", index_gz_start, index_gz_end, index_start, index_end,
+                                       "\"" INDEX_HTML_HASH "\"", "no-cache"};
+    return http_sendAsset(req, &asset);
+}
 static const httpd_uri_t index_page = {
     .uri = "/", .method = HTTP_GET, .handler = index_page_get_handler, .user_ctx = NULL};
 
 typedef enum { update_none, update_module, update_controller } update_firmware_t;
 
-static esp_err_t firmware_handler(httpd_req_t *req)
+typedef struct {
+    update_firmware_t update;
+    size_t offset;
+    multipart_t multipart;
+    char buf[HTTP_FIRMWARE_RECV_LEN];
+} firmware_upload_t;
+
+static bool firmware_part(const char *name, void *arg)
 {
-    static update_firmware_t update = update_none;
-    controller_queue_data_t *controller_comm = calloc(1, sizeof(controller_queue_data_t));
-    int read_cnt = 0;
-    int boundry_length = 0;
-    while (read_cnt <= 4 || controller_comm->data[read_cnt - 4] != '\r' ||
-           controller_comm->data[read_cnt - 3] != '\n' || controller_comm->data[read_cnt - 2] != '\r' ||
-           controller_comm->data[read_cnt - 1] != '\n') {
-        if (httpd_req_recv_blocking(req, controller_comm->data + read_cnt, 1) <= 0) {
-            return ESP_FAIL;
-        }
-        read_cnt++;
-        if (!boundry_length && controller_comm->data[read_cnt - 2] == '\r' &&
-            controller_comm->data[read_cnt - 1] == '\n')
-            boundry_length = read_cnt + 4;
-    }
-    ESP_LOGI(TAG, "boundry len %d", boundry_length);
-    ESP_LOGI(TAG, "%s", controller_comm->data);
-    regex_t b;
-    regmatch_t groupArray[5];
-    b.re_magic = 0;
-    int reti;
-    reti = regcomp(&b, "name=\"([a-z_]*)\"", REG_EXTENDED);
-    if (reti) {
-        printf("Can't compile re\r\n");
+    firmware_upload_t *upload = arg;
+    upload->offset = 0;
+    if (!strcmp(name, "controller_firmware")) {
+        upload->update = update_controller;
+        ESP_LOGI(TAG, "command: update_controller");
+    } else if (!strcmp(name, "module_firmware")) {
+        upload->update = update_module;
+        ESP_LOGI(TAG, "command: update_module");
     } else {
-        reti = regexec(&b, controller_comm->data, 5, groupArray, 0);
-        if (!reti) {
-            for (int g = 0; g < 5; g++) {
-                if (groupArray[g].rm_so == (size_t)-1)
-                    break; // No more groups
-                controller_comm->data[groupArray[g].rm_eo] = 0;
-                if (g == 1) {
-                    if (!strcmp(controller_comm->data + groupArray[g].rm_so, "controller_firmware")) {
-                        update = update_controller;
-                        ESP_LOGI(TAG, "command: update_controller");
-                    } else if (!strcmp(controller_comm->data + groupArray[g].rm_so, "module_firmware")) {
-                        update = update_module;
-                        ESP_LOGI(TAG, "command: update_module");
-                    } else {
-                        ESP_LOGI(TAG, "command: undefined");
-                    }
-                }
-            }
-        }
+        upload->update = update_none;
+        ESP_LOGI(TAG, "command: undefined");
     }
-    regfree(&b);
-    controller_comm->total_data_len = req->content_len - read_cnt - boundry_length;
-    controller_comm->data_len = CMD_COMM_BUF_LEN;
-    controller_comm->data_offset = 0;
+    return true;
+}
 
-    ESP_LOGI(TAG, "total useful data len %d, + boundry %d", controller_comm->total_data_len, req->content_len);
-    ESP_LOGI(TAG, "already read %d, after data read %d", read_cnt, boundry_length);
+// The size of the image is only known once the closing delimiter has been found, so it is passed with the last block.
+static bool firmware_data(const char *data, size_t len, bool final, void *arg)
+{
+    firmware_upload_t *upload = arg;
+    size_t total = final ? upload->offset + len : 0;
+    if (upload->update == update_controller) {
+        flap_controller_firmware_update((char *)data, len, upload->offset, total);
+    } else if (upload->update == update_module) {
+        flap_module_firmware_update((char *)data, len, upload->offset, total);
+    }
+    upload->offset += len;
+    return true;
+}
 
-    bzero(controller_comm->data, CMD_COMM_BUF_LEN);
-    while (controller_comm->data_offset + controller_comm->data_len < controller_comm->total_data_len) {
-        if (httpd_req_recv_blocking(req, controller_comm->data, controller_comm->data_len) <= 0) {
-            return ESP_FAIL;
-        }
-        if (update == update_controller) {
-            flap_controller_firmware_update(controller_comm->data, controller_comm->data_len,
-                                            controller_comm->data_offset, controller_comm->total_data_len);
-        } else if (update == update_module) {
-            flap_module_firmware_update(controller_comm->data, controller_comm->data_len, controller_comm->data_offset,
-                                        controller_comm->total_data_len);
-        }
-        controller_comm->data_offset += controller_comm->data_len;
+static esp_err_t firmware_handler(httpd_req_t *req)
+{
+    char contentType[128];
+    if (httpd_req_get_hdr_value_str(req, "Content-Type", contentType, sizeof(contentType)) != ESP_OK) {
+        httpd_resp_set_status(req, "400 Bad Request");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
     }
+    firmware_upload_t *upload = malloc(sizeof(firmware_upload_t));
+    if (!upload) {
+        ESP_LOGE(TAG, "Failed to allocate memory for the firmware upload");
+        return ESP_ERR_NO_MEM;
+    }
+    upload->update = update_none;
+    upload->offset = 0;
+    bool ok = multipart_init(&upload->multipart, contentType, firmware_part, firmware_data, upload);
 
-    controller_comm->data_len = controller_comm->total_data_len - controller_comm->data_offset;
-    if (controller_comm->data_len) {
-        if (httpd_req_recv_blocking(req, controller_comm->data, controller_comm->data_len) <= 0) {
+    size_t remaining = req->content_len;
+    while (remaining && ok) {
+        int recv_cnt = httpd_req_recv(req, upload->buf, remaining < sizeof(upload->buf) ? remaining : sizeof(upload->buf));
+        if (recv_cnt == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        } else if (recv_cnt <= 0) {
+            ESP_LOGE(TAG, "Failed to receive firmware");
+            free(upload);
             return ESP_FAIL;
         }
-        if (update == update_controller) {
-            flap_controller_firmware_update(controller_comm->data, controller_comm->data_len,
-                                            controller_comm->data_offset, controller_comm->total_data_len);
-        } else if (update == update_module) {
-            flap_module_firmware_update(controller_comm->data, controller_comm->data_len, controller_comm->data_offset,
-                                        controller_comm->total_data_len);
-        }
-        controller_comm->data_offset += controller_comm->data_len;
-    }
-    if (httpd_req_recv_blocking(req, controller_comm->data, boundry_length) <= 0) {
-        return ESP_FAIL;
+        ok = multipart_feed(&upload->multipart, upload->buf, recv_cnt);
+        remaining -= recv_cnt;
     }
-    ESP_LOGI(TAG, "%.*s", boundry_length, controller_comm->data);
-
-    free(controller_comm);
+    ok &= multipart_isDone(&upload->multipart);
+    update_firmware_t update = upload->update;
+    ESP_LOGI(TAG, "Received %d bytes of firmware", upload->offset);
+    free(upload);
 
+    if (!ok) {
+        httpd_resp_set_status(req, "400 Bad Request");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
     httpd_resp_set_status(req, "204 No Content");
     httpd_resp_set_type(req, "text/html");
     httpd_resp_send(req, NULL, 0);
@@ -154,18 +215,18 @@ static const httpd_uri_t firmware_uri = {
 
 static esp_err_t style_get_handler(httpd_req_t *req)
 {
-    httpd_resp_set_type(req, "text/css");
-    httpd_resp_send(req, (const char *)style_start, style_end - style_start);
-    return ESP_OK;
+    static const http_asset_t asset = {"text/css", style_gz_start, style_gz_end, style_start, style_end,
+                                       "\"" STYLE_CSS_HASH "\"", "public, max-age=" HTTP_ASSET_MAX_AGE};
+    return http_sendAsset(req, &asset);
 }
 static const httpd_uri_t style_uri = {
     .uri = "/style.css", .method = HTTP_GET, .handler = style_get_handler, .user_ctx = NULL};
 
 static esp_err_t favicon_get_handler(httpd_req_t *req)
 {
-    httpd_resp_set_type(req, "image/svg+xml");
-    httpd_resp_send(req, (const char *)favicon_start, favicon_end - favicon_start);
-    return ESP_OK;
+    static const http_asset_t asset = {"image/svg+xml", favicon_gz_start, favicon_gz_end, favicon_start, favicon_end,
+                                       "\"" FAVICON_SVG_HASH "\"", "public, max-age=" HTTP_ASSET_MAX_AGE};
+    return http_sendAsset(req, &asset);
 }
 
 static const httpd_uri_t favicon_uri = {
@@ -173,15 +234,15 @@ static const httpd_uri_t favicon_uri = {
 
 static esp_err_t script_get_handler(httpd_req_t *req)
 {
-    httpd_resp_set_type(req, "text/javascript");
-    httpd_resp_send(req, (const char *)script_start, script_end - script_start);
-    return ESP_OK;
+    static const http_asset_t asset = {"text/javascript", script_gz_start, script_gz_end, script_start, script_end,
+                                       "\"" SCRIPT_JS_HASH "\"", "public, max-age=" HTTP_ASSET_MAX_AGE};
+    return http_sendAsset(req, &asset);
 }
 
 static const httpd_uri_t script_uri = {
     .uri = "/script.js", .method = HTTP_GET, .handler = script_get_handler, .user_ctx = NULL};
 
-void http_addModulePropertyHandler(moduleProperty_t property, http_modulePropertyCallback_t toJson,
+void http_addModulePropertyHandler(moduleProperty_t property, http_modulePropertyWriter_t toJson,
                                    http_modulePropertyCallback_t fromJson)
 {
     if (property <= no_property && property >= end_of_properties) {
@@ -192,177 +253,1186 @@ void http_addModulePropertyHandler(moduleProperty_t property, http_modulePropert
     http_modulePropertyHandlers[property].fromJson = fromJson;
 }
 
+void http_jsonFlush(http_jsonWriter_t *writer)
+{
+    if (writer->len && writer->err == ESP_OK) {
+        writer->err = writer->send(writer, false);
+        writer->sentCnt++;
+    }
+    writer->len = 0;
+}
+
+void http_jsonFinish(http_jsonWriter_t *writer)
+{
+    if (writer->err == ESP_OK) {
+        writer->err = writer->send(writer, true);
+        writer->sentCnt++;
+    }
+    writer->len = 0;
+}
+
+static esp_err_t http_jsonSendChunk(http_jsonWriter_t *writer, bool final)
+{
+    esp_err_t err = ESP_OK;
+    if (writer->len) {
+        err = httpd_resp_send_chunk(writer->arg, writer->buf, writer->len);
+    }
+    if (final && err == ESP_OK) {
+        err = httpd_resp_send_chunk(writer->arg, NULL, 0);
+    }
+    return err;
+}
+
+void http_jsonWriteRaw(http_jsonWriter_t *writer, const char *data, size_t len)
+{
+    while (len) {
+        if (writer->len == HTTP_CHUNK_LEN) {
+            http_jsonFlush(writer);
+        }
+        size_t n = HTTP_CHUNK_LEN - writer->len;
+        n = n < len ? n : len;
+        memcpy(writer->buf + writer->len, data, n);
+        writer->len += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void http_jsonWriteString(http_jsonWriter_t *writer, const char *string, size_t maxLen)
+{
+    http_jsonWriteRaw(writer, "\"", 1);
+    for (size_t i = 0; string && i < maxLen && string[i]; i++) {
+        char c = string[i];
+        if (c == '"' || c == '\\') {
+            char escaped[2] = {'\\', c};
+            http_jsonWriteRaw(writer, escaped, 2);
+        } else if ((uint8_t)c < 0x20) {
+            char escaped[7];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            http_jsonWriteRaw(writer, escaped, 6);
+        } else {
+            http_jsonWriteRaw(writer, &c, 1);
+        }
+    }
+    http_jsonWriteRaw(writer, "\"", 1);
+}
+
+void http_jsonWriteNumber(http_jsonWriter_t *writer, int number)
+{
+    char buf[12];
+    http_jsonWriteRaw(writer, buf, snprintf(buf, sizeof(buf), "%d", number));
+}
+
+void http_jsonWriteBool(http_jsonWriter_t *writer, bool value)
+{
+    http_jsonWriteRaw(writer, value ? "true" : "false", value ? 4 : 5);
+}
+
+// Parses a comma separated list of property names. "all" selects every property.
+static uint64_t http_parsePropertyList(const char *list)
+{
+    uint64_t properties = 0;
+    if (strcmp(list, "all") == 0) {
+        return ~properties;
+    }
+    while (*list) {
+        size_t len = strcspn(list, ",");
+        for (moduleProperty_t p = no_property + 1; p < end_of_properties; p++) {
+            const char *name = get_property_name(p);
+            if (strlen(name) == len && strncmp(list, name, len) == 0) {
+                properties |= (1 << p);
+            }
+        }
+        list += len;
+        list += (*list == ',');
+    }
+    return properties;
+}
+
+// Writes a module object with the given properties. A module that is turning towards its character also gets the
+// predicted time in ms until it shows it as "eta".
+static void http_jsonWriteModule(http_jsonWriter_t *writer, size_t index, module_t *module, uint64_t properties)
+{
+    http_jsonWriteRaw(writer, "{\"module\":", 10);
+    http_jsonWriteNumber(writer, index);
+    uint32_t eta = properties & (1 << character_property) ? module_getEtaMs(module) : 0;
+    if (eta) {
+        http_jsonWriteRaw(writer, ",\"eta\":", 7);
+        http_jsonWriteNumber(writer, eta);
+    }
+    for (moduleProperty_t p = no_property + 1; p < end_of_properties; p++) {
+        if (properties & (1 << p) && http_modulePropertyHandlers[p].toJson) {
+            const char *name = get_property_name(p);
+            http_jsonWriteRaw(writer, ",", 1);
+            http_jsonWriteString(writer, name, strlen(name));
+            http_jsonWriteRaw(writer, ":", 1);
+            http_modulePropertyHandlers[p].toJson(writer, module);
+        }
+    }
+    http_jsonWriteRaw(writer, "}", 1);
+}
+
+// Copies a module of the back frame, so it can be written to a slow client without holding the frame lock. The copy
+// holds a reference to the characterMap until it is released. Returns false if there is no module at index.
+static bool http_copyBackModule(size_t index, module_t *copy)
+{
+    display_lock();
+    if (index >= display_getSize()) {
+        display_unlock();
+        return false;
+    }
+    *copy = *display_getBackModule(index);
+    copy->firmwareVersion = NULL;
+    if (copy->characterMap) {
+        copy->characterMap->reffCnt++;
+    }
+    display_unlock();
+    return true;
+}
+
+static void http_releaseModuleCopy(module_t *copy)
+{
+    display_lock(); // the reference count of a characterMap is shared by both frames.
+    characterMap_delete(copy->characterMap);
+    display_unlock();
+}
+
 esp_err_t api_get_http_modulePropertyHandlers(httpd_req_t *req)
 {
+    if (!http_isAsyncWorker()) {
+        return http_queueAsync(req, api_get_http_modulePropertyHandlers);
+    }
     ESP_LOGI(TAG, "GET request on %s", req->uri);
     ulTaskNotifyTake(true, 0);
-    char buf[MAX_HTTP_BODY_SIZE] = {0};
-    strcpy(buf, "[");
 
+    uint64_t requestedProperties = 0;
     for (moduleProperty_t p = no_property + 1; p < end_of_properties; p++) {
         if (http_modulePropertyHandlers[p].toJson) {
-            display_requestModuleProperty(p);
+            requestedProperties |= (1 << p);
         }
     }
-    uint64_t requestedProperties = display_getRequestModuleProperties();
 
-    // process
-    model_preformUart();
+    // "?fields=character,offset" selects the properties and "?range=start,end" the modules [start, end) to return.
+    // "?refresh=all" or "?refresh=character,offset" bypasses the property cache.
+    char query[HTTP_QUERY_LEN];
+    char value[HTTP_QUERY_LEN];
+    bool hasQuery = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK;
+    size_t rangeStart = 0;
+    size_t rangeEnd = SIZE_MAX;
+    if (hasQuery && httpd_query_key_value(query, "fields", value, sizeof(value)) == ESP_OK) {
+        requestedProperties &= http_parsePropertyList(value);
+    }
+    if (hasQuery && httpd_query_key_value(query, "range", value, sizeof(value)) == ESP_OK) {
+        unsigned int start, end;
+        if (sscanf(value, "%u,%u", &start, &end) != 2 || start > end) {
+            httpd_resp_set_status(req, "400 Bad Request");
+            httpd_resp_send(req, NULL, 0);
+            return ESP_OK;
+        }
+        rangeStart = start;
+        rangeEnd = end;
+    }
+    if (hasQuery && httpd_query_key_value(query, "refresh", value, sizeof(value)) == ESP_OK) {
+        display_invalidateModuleProperties(http_parsePropertyList(value) & requestedProperties);
+    }
+
+    // only properties that are not cached or have outlived their ttl are read from the chain.
+    uint64_t staleProperties = display_getStaleModuleProperties(requestedProperties);
+    if (staleProperties) {
+        for (moduleProperty_t p = no_property + 1; p < end_of_properties; p++) {
+            if (staleProperties & (1 << p)) {
+                display_requestModuleProperty(p);
+            }
+        }
+        model_preformUart();
+    }
 
     // populate json
     httpd_resp_set_status(req, "200 OK");
     httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
     httpd_resp_set_hdr(req, "Access-Control-Allow-Headers", "Content-Type");
     httpd_resp_set_type(req, "application/json");
-    if (display_getSize()) {
-        for (size_t i = 0; i < display_getSize();) {
-            ESP_LOGI(TAG, "getting info of module %d", i);
-            cJSON *json = cJSON_CreateObject();
-            module_t *module = display_getModule(i);
-            if (!module) {
-                ESP_LOGE(TAG, "display object is missing module %d", i);
-                continue;
+
+    http_jsonWriter_t writer = {.send = http_jsonSendChunk, .arg = req, .err = ESP_OK, .sentCnt = 0, .len = 0};
+    http_jsonWriteRaw(&writer, "[", 1);
+    for (size_t i = rangeStart; i < rangeEnd && writer.err == ESP_OK; i++) {
+        module_t module;
+        if (!http_copyBackModule(i, &module)) {
+            break;
+        }
+        if (i != rangeStart) {
+            http_jsonWriteRaw(&writer, ",", 1);
+        }
+        http_jsonWriteModule(&writer, i, &module, requestedProperties);
+        http_releaseModuleCopy(&module);
+    }
+    http_jsonWriteRaw(&writer, "]", 1);
+    http_jsonFinish(&writer);
+    return ESP_OK;
+}
+
+#define HTTP_MAX_ARRAY_LEN 64
+
+// State of the module objects parsed from a streamed POST body.
+typedef struct {
+    int depth;
+    int moduleIndex;
+    bool isModuleKey;
+    moduleProperty_t property;          // property of the current key, no_property if it is ignored.
+    cJSON *values[end_of_properties];   // values of the current module object, applied at the end of the object.
+} http_moduleParser_t;
+
+static void http_moduleParserReset(http_moduleParser_t *parser)
+{
+    for (moduleProperty_t p = no_property + 1; p < end_of_properties; p++) {
+        cJSON_Delete(parser->values[p]);
+        parser->values[p] = NULL;
+    }
+    parser->moduleIndex = -1;
+    parser->isModuleKey = false;
+    parser->property = no_property;
+}
+
+static bool http_moduleParserApply(http_moduleParser_t *parser)
+{
+    if (parser->moduleIndex < 0) {
+        ESP_LOGE(TAG, "no module specified, ignoring this object");
+        return false;
+    }
+    display_lock(); // changes are written to the back frame, the model task publishes them.
+    module_t *module = display_getBackModule(parser->moduleIndex);
+    if (!module) {
+        ESP_LOGE(TAG, "module %d is invalid, ignoring this object", parser->moduleIndex);
+        display_unlock();
+        return false;
+    }
+    for (moduleProperty_t p = no_property + 1; p < end_of_properties; p++) {
+        if (parser->values[p] && !http_modulePropertyHandlers[p].fromJson(&parser->values[p], module)) {
+            display_unlock();
+            return false;
+        }
+    }
+    display_unlock();
+    return true;
+}
+
+static cJSON *http_jsonStreamValue(jsonStream_event_t event, const char *token)
+{
+    switch (event) {
+        case jsonStream_string:
+            return cJSON_CreateString(token);
+        case jsonStream_number:
+            return cJSON_CreateNumber(strtod(token, NULL));
+        case jsonStream_true:
+            return cJSON_CreateTrue();
+        case jsonStream_false:
+            return cJSON_CreateFalse();
+        case jsonStream_null:
+            return cJSON_CreateNull();
+        default:
+            return NULL;
+    }
+}
+
+// The body is an array of module objects. Property values are scalars or arrays of scalars, they are collected per
+// module object and passed to the fromJson handlers once the object is complete.
+static bool http_moduleParserCallback(jsonStream_event_t event, const char *token, size_t len, void *arg)
+{
+    http_moduleParser_t *parser = arg;
+    switch (event) {
+        case jsonStream_objectStart:
+        case jsonStream_arrayStart:
+            parser->depth++;
+            if (parser->depth == 1) {
+                return event == jsonStream_arrayStart;
+            } else if (parser->depth == 2) {
+                http_moduleParserReset(parser);
+                return event == jsonStream_objectStart;
+            } else if (parser->depth == 3 && event == jsonStream_arrayStart) {
+                if (parser->property == no_property) {
+                    return true; // unknown properties are ignored.
+                }
+                cJSON_Delete(parser->values[parser->property]);
+                parser->values[parser->property] = cJSON_CreateArray();
+                return parser->values[parser->property] != NULL;
             }
-            cJSON_AddNumberToObject(json, "module", i);
+            return false;
+        case jsonStream_objectEnd:
+        case jsonStream_arrayEnd:
+            parser->depth--;
+            if (parser->depth == 1) {
+                bool ok = http_moduleParserApply(parser);
+                http_moduleParserReset(parser);
+                return ok;
+            }
+            return true;
+        case jsonStream_key:
+            parser->isModuleKey = strcmp(token, "module") == 0;
+            parser->property = no_property;
             for (moduleProperty_t p = no_property + 1; p < end_of_properties; p++) {
-                cJSON *property = NULL;
-                if (requestedProperties & (1 << p) && http_modulePropertyHandlers[p].toJson) {
-                    http_modulePropertyHandlers[p].toJson(&property, module);
-                    cJSON_AddItemToObject(json, get_property_name(p), property);
+                if (http_modulePropertyHandlers[p].fromJson && strcmp(token, get_property_name(p)) == 0) {
+                    parser->property = p;
                 }
             }
+            return true;
+        default:
+            break;
+    }
 
-            size_t buf_offset = strlen(buf);
-            if (!cJSON_PrintPreallocated(json, buf + buf_offset, MAX_HTTP_BODY_SIZE - buf_offset - 10, true)) {
-                memset(buf + buf_offset, 0, MAX_HTTP_BODY_SIZE - buf_offset);
-                httpd_resp_send_chunk(req, (const char *)buf, strlen(buf));
-                memset(buf, 0, MAX_HTTP_BODY_SIZE);
-            } else if (i == display_getSize() - 1) {
-                strcat(buf, "]");
-                httpd_resp_send_chunk(req, (const char *)buf, strlen(buf));
-                memset(buf, 0, MAX_HTTP_BODY_SIZE);
-                i++;
-            } else {
-                strcat(buf, ",");
-                i++;
-            }
-            cJSON_Delete(json);
+    // scalar value
+    if (parser->depth == 2 && parser->isModuleKey) {
+        if (event != jsonStream_number) {
+            return false;
         }
-        httpd_resp_send_chunk(req, NULL, 0);
-    } else {
-        httpd_resp_send(req, "[]", 2);
+        parser->moduleIndex = atoi(token);
+        return true;
+    } else if (parser->property == no_property) {
+        return parser->depth <= 3; // unknown properties are ignored.
     }
-    return ESP_OK;
+    cJSON *value = http_jsonStreamValue(event, token);
+    if (!value) {
+        return false;
+    }
+    if (parser->depth == 2) {
+        cJSON_Delete(parser->values[parser->property]);
+        parser->values[parser->property] = value;
+        return true;
+    } else if (parser->depth == 3 && cJSON_GetArraySize(parser->values[parser->property]) < HTTP_MAX_ARRAY_LEN) {
+        cJSON_AddItemToArray(parser->values[parser->property], value);
+        return true;
+    }
+    cJSON_Delete(value);
+    return false;
+}
+
+// Answers a write with the predicted time in ms until every module shows its character: {"eta":1200}
+static esp_err_t http_sendEta(httpd_req_t *req, const char *status)
+{
+    char body[24];
+    snprintf(body, sizeof(body), "{\"eta\":%lu}", (unsigned long)display_getEtaMs());
+    httpd_resp_set_status(req, status);
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, body);
+}
+
+// Answers 409 during a calibration, the characters the modules show must not change until its offsets are set.
+static bool http_rejectDuringCalibration(httpd_req_t *req)
+{
+    if (!calibration_isActive()) {
+        return false;
+    }
+    ESP_LOGW(TAG, "Rejected %s during the calibration", req->uri);
+    httpd_resp_set_status(req, "409 Conflict");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_resp_send(req, NULL, 0);
+    return true;
 }
+
 esp_err_t api_set_http_modulePropertyHandlers(httpd_req_t *req)
 {
+    if (!http_isAsyncWorker()) {
+        return http_queueAsync(req, api_set_http_modulePropertyHandlers);
+    }
     ESP_LOGI(TAG, "POST request on %s", req->uri);
+    if (http_rejectDuringCalibration(req)) {
+        return ESP_OK;
+    }
     ulTaskNotifyTake(true, 0);
-    char buf[MAX_HTTP_BODY_SIZE] = {0};
-    size_t to_parse_size = 0;
-    int recv_cnt = 0;
-    // Receive data. Only a json array is starting with '[' at index 0 is accepted. A large json can be read an parsed
-    // in multiple sections.
-    while ((recv_cnt = httpd_req_recv(req, buf + to_parse_size, MAX_HTTP_BODY_SIZE - 1 - to_parse_size))) {
-        size_t json_last_object_end = 0;
-        size_t json_first_object_start = 0;
-        size_t json_object_token_cnt = 0;
-
-        if (buf[0] != '[') {
-            httpd_resp_set_status(req, "422 Unprocessable Entity");
-            httpd_resp_send(req, NULL, 0);
-            return ESP_OK;
-        }
+    char buf[HTTP_CHUNK_LEN];
+    http_moduleParser_t parser = {.depth = 0};
+    jsonStream_t stream;
+    jsonStream_init(&stream, http_moduleParserCallback, &parser);
+    http_moduleParserReset(&parser);
 
-        for (int i = 0; i < MAX_HTTP_BODY_SIZE - 1; i++) {
-            if (json_object_token_cnt == 0 && buf[i] == ']') {
-                break;
-            } else if (buf[i] == '{') {
-                if (++json_object_token_cnt == 1 && json_first_object_start == 0) {
-                    json_first_object_start = i;
-                }
-            } else if (buf[i] == '}') {
-                if (--json_object_token_cnt == 0) {
-                    json_last_object_end = i;
-                }
-            }
+    // The body is parsed while it is received, modules are applied as soon as their object is complete.
+    size_t remaining = req->content_len;
+    bool ok = true;
+    while (remaining && ok) {
+        int recv_cnt = httpd_req_recv(req, buf, remaining < sizeof(buf) ? remaining : sizeof(buf));
+        if (recv_cnt == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        } else if (recv_cnt <= 0) {
+            ESP_LOGE(TAG, "Failed to receive request body");
+            http_moduleParserReset(&parser);
+            return ESP_FAIL;
         }
+        ok = jsonStream_feed(&stream, buf, recv_cnt);
+        remaining -= recv_cnt;
+    }
+    http_moduleParserReset(&parser);
+    if (!ok || !jsonStream_isDone(&stream)) {
+        ESP_LOGE(TAG, "Failed to parse json");
+        httpd_resp_set_status(req, "422 Unprocessable Entity");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
 
-        if (json_first_object_start == 0 || json_first_object_start > json_last_object_end ||
-            json_last_object_end == MAX_HTTP_BODY_SIZE) {
-            httpd_resp_set_status(req, "422 Unprocessable Entity");
-            httpd_resp_send(req, NULL, 0);
-            return ESP_OK;
+    if (!model_preformUart()) {
+        ESP_LOGE(TAG, "Controller has not responded.");
+        httpd_resp_set_status(req, "500 Internal Server Error");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
+
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Headers", "Content-Type");
+    return http_sendEta(req, "200 OK");
+}
+
+static size_t http_utf8Length(char lead)
+{
+    if (((uint8_t)lead & 0xE0) == 0xC0) {
+        return 2;
+    } else if (((uint8_t)lead & 0xF0) == 0xE0) {
+        return 3;
+    } else if (((uint8_t)lead & 0xF8) == 0xF0) {
+        return 4;
+    }
+    return 1;
+}
+
+// Writes a character index per module into the back frame, starting at module start. Indices outside of the
+// character map of their module are skipped.
+static bool http_setFrameIndices(const uint8_t *indices, size_t len, size_t start)
+{
+    bool valid = true;
+    display_lock(); // changes are written to the back frame, the model task publishes them.
+    for (size_t i = 0; i < len && start + i < display_getSize(); i++) {
+        module_t *backModule = display_getBackModule(start + i);
+        if (indices[i] < module_getCharacterMapSize(backModule)) {
+            module_setCharacterIndex(backModule, indices[i]);
+        } else {
+            valid = false;
         }
-        buf[json_last_object_end + 1] = ']';
-        buf[json_first_object_start - 1] = '[';
+    }
+    display_unlock();
+    return valid;
+}
 
-        // parse object
-        to_parse_size = to_parse_size + recv_cnt - json_last_object_end - 1;
+// Parses "?transition=none|wave|sweep|cascade" and "?duration=" (ms over which the modules start) of a query.
+static bool http_parseTransition(const char *query, Transition_t *transition)
+{
+    char value[HTTP_QUERY_LEN];
+    *transition = (Transition_t){.type = transition_none, .durationMs = 0};
+    if (httpd_query_key_value(query, "transition", value, sizeof(value)) == ESP_OK &&
+        !display_parseTransition(value, transition)) {
+        return false;
+    }
+    if (httpd_query_key_value(query, "duration", value, sizeof(value)) == ESP_OK) {
+        unsigned long duration = strtoul(value, NULL, 10);
+        transition->durationMs = duration < UINT16_MAX ? duration : UINT16_MAX;
+    }
+    return true;
+}
 
-        cJSON *json = cJSON_ParseWithLength(buf, json_last_object_end + 2);
-        if (!json || !cJSON_IsArray(json)) {
-            ESP_LOGE(TAG, "Failed to parse json");
-            httpd_resp_set_status(req, "500 Internal Server Error");
-            httpd_resp_send(req, NULL, 0);
-            return ESP_OK;
+// Maps the entries of a frame body to modules. Without a region the entries follow the chain order from module start,
+// with a region they fill the rectangle row by row.
+typedef struct {
+    bool isRegion;
+    size_t start;
+    size_t x;
+    size_t y;
+    size_t width;
+    size_t height;
+} http_frameRegion_t;
+
+// Returns the module of an entry, or -1 if the entry is outside of the display.
+static int http_frameModule(http_frameRegion_t *region, size_t entry)
+{
+    if (region->isRegion) {
+        return display_getModuleIndex(region->x + entry % region->width, region->y + entry / region->width);
+    }
+    return region->start + entry < display_getSize() ? region->start + entry : -1;
+}
+
+// Writes a frame of characters into the back frame. The body holds one entry per module, by default in chain order
+// starting at module "?start=". "?region=x,y,width,height" addresses a rectangle of the display and "?row=" a single
+// row, the entries then fill the region row by row. "?format=index" (default) takes a character index byte per module,
+// "?format=utf8" takes UTF-8 encoded characters. "?length=" limits the number of entries. Only the addressed modules
+// are marked for an update. "?transition=" and "?duration=" stagger the start of the modules, see Transition_t.
+static esp_err_t api_set_frame_handler(httpd_req_t *req)
+{
+    if (!http_isAsyncWorker()) {
+        return http_queueAsync(req, api_set_frame_handler);
+    }
+    ESP_LOGI(TAG, "POST request on %s", req->uri);
+    if (http_rejectDuringCalibration(req)) {
+        return ESP_OK;
+    }
+    char query[HTTP_QUERY_LEN];
+    char value[HTTP_QUERY_LEN];
+    bool hasQuery = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK;
+    http_frameRegion_t region = {.isRegion = false, .start = 0};
+    size_t length = SIZE_MAX;
+    bool utf8 = false;
+    bool badRequest = false;
+    if (hasQuery && httpd_query_key_value(query, "start", value, sizeof(value)) == ESP_OK) {
+        region.start = strtoul(value, NULL, 10);
+    }
+    if (hasQuery && httpd_query_key_value(query, "region", value, sizeof(value)) == ESP_OK) {
+        unsigned int x, y, width, height;
+        badRequest |= sscanf(value, "%u,%u,%u,%u", &x, &y, &width, &height) != 4 || !width || !height;
+        region = (http_frameRegion_t){.isRegion = true, .x = x, .y = y, .width = width, .height = height};
+    } else if (hasQuery && httpd_query_key_value(query, "row", value, sizeof(value)) == ESP_OK) {
+        if (display_getStaleModuleProperties(1 << columnEnd_property)) {
+            display_requestModuleProperty(columnEnd_property); // the width of the display follows from colEnd.
+            model_preformUart();
         }
+        region = (http_frameRegion_t){
+            .isRegion = true, .x = 0, .y = strtoul(value, NULL, 10), .width = display_getWidth(), .height = 1};
+        badRequest |= !region.width;
+    }
+    if (hasQuery && httpd_query_key_value(query, "length", value, sizeof(value)) == ESP_OK) {
+        length = strtoul(value, NULL, 10);
+    }
+    if (hasQuery && httpd_query_key_value(query, "format", value, sizeof(value)) == ESP_OK) {
+        utf8 = strcmp(value, "utf8") == 0;
+        badRequest |= !utf8 && strcmp(value, "index") != 0;
+    }
+    Transition_t transition = {.type = transition_none};
+    badRequest |= hasQuery && !http_parseTransition(query, &transition);
+    if (badRequest) {
+        httpd_resp_set_status(req, "400 Bad Request");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
+    size_t entryCnt = region.isRegion ? region.width * region.height : display_getSize() - region.start;
+    entryCnt = region.isRegion || region.start < display_getSize() ? entryCnt : 0;
+    entryCnt = length < entryCnt ? length : entryCnt;
 
-        cJSON *json_module = NULL;
-        cJSON_ArrayForEach(json_module, json)
-        {
-            cJSON *json_module_index = cJSON_GetObjectItemCaseSensitive(json_module, "module");
-            if (!cJSON_IsNumber(json_module_index)) {
-                ESP_LOGE(TAG, "no module specified, ignoring this object");
-                cJSON_Delete(json);
-                httpd_resp_set_status(req, "422 Unprocessable Entity");
-                httpd_resp_send(req, NULL, 0);
-                return ESP_OK;
-            }
-            module_t *module = display_getModule(json_module_index->valueint);
-            if (!module) {
-                ESP_LOGE(TAG, "module %d is invalid, ignoring this object", json_module_index->valueint);
-                cJSON_Delete(json);
-                httpd_resp_set_status(req, "422 Unprocessable Entity");
-                httpd_resp_send(req, NULL, 0);
-                return ESP_OK;
-            }
-            char *string = cJSON_Print(json_module);
-            ESP_LOGI(TAG, "%s", string);
-            free(string);
-            for (moduleProperty_t p = no_property + 1; p < end_of_properties; p++) {
-                cJSON *property = cJSON_GetObjectItemCaseSensitive(json_module, get_property_name(p));
-                if (property && http_modulePropertyHandlers[p].fromJson) {
-                    if (!http_modulePropertyHandlers[p].fromJson(&property, module)) {
-                        cJSON_Delete(json);
-                        httpd_resp_set_status(req, "422 Unprocessable Entity");
-                        httpd_resp_send(req, NULL, 0);
-                        return ESP_OK;
+    char buf[HTTP_CHUNK_LEN + 4]; // room for a UTF-8 character split over two chunks.
+    size_t entry = 0;
+    size_t pending = 0;
+    size_t remaining = req->content_len;
+    bool valid = true;
+    while (remaining) {
+        int recv_cnt = httpd_req_recv(req, buf + pending, remaining < HTTP_CHUNK_LEN ? remaining : HTTP_CHUNK_LEN);
+        if (recv_cnt == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        } else if (recv_cnt <= 0) {
+            ESP_LOGE(TAG, "Failed to receive frame");
+            return ESP_FAIL;
+        }
+        remaining -= recv_cnt;
+        size_t len = pending + recv_cnt;
+        size_t i = 0;
+        display_lock(); // changes are written to the back frame, the model task publishes them.
+        while (i < len && entry < entryCnt) {
+            int module = http_frameModule(&region, entry);
+            module_t *backModule = module >= 0 ? display_getBackModule(module) : NULL;
+            int index;
+            if (!utf8) {
+                index = (uint8_t)buf[i++];
+            } else {
+                char character[4];
+                if (i + http_utf8Length(buf[i]) > len) {
+                    if (remaining) {
+                        break; // the rest of this character is in the next chunk.
                     }
+                    valid = false;
+                    i = len;
+                    break;
                 }
+                size_t n = utf8_getCharacter(buf + i, character);
+                i += n ? n : 1;
+                index = backModule ? characterMap_getNearestIndex(backModule->characterMap, character,
+                                                                  backModule->characterIndex)
+                                   : 0;
+            }
+            entry++;
+            if (!backModule) {
+                continue; // the region reaches beyond the display.
+            }
+            if (index >= 0 && index < module_getCharacterMapSize(backModule)) {
+                module_setCharacterIndex(backModule, index);
+            } else {
+                valid = false;
             }
         }
-        cJSON_Delete(json);
-        memcpy(buf + 1, buf + json_last_object_end + 2, to_parse_size - 1);
-        memset(buf + to_parse_size, 0, MAX_HTTP_BODY_SIZE - to_parse_size);
+        display_unlock();
+        pending = i < len && entry < entryCnt ? len - i : 0;
+        memmove(buf, buf + i, pending);
     }
 
-    xTaskNotify(modelTask(), fromHttp, eSetValueWithoutOverwrite);
-    uint32_t event = ulTaskNotifyTake(true, 10000 / portTICK_RATE_MS);
-    if (!event) {
+    if (transition.type != transition_none) {
+        display_setTransition(&transition);
+    }
+    if (!model_preformUart()) {
         ESP_LOGE(TAG, "Controller has not responded.");
         httpd_resp_set_status(req, "500 Internal Server Error");
         httpd_resp_send(req, NULL, 0);
         return ESP_OK;
     }
 
+    // characters that are not in the character map of their module are skipped.
+    return http_sendEta(req, valid ? "200 OK" : "422 Unprocessable Entity");
+}
+
+static const httpd_uri_t api_set_frame_endpoint = {
+    .uri = "/api/frame", .method = HTTP_POST, .handler = api_set_frame_handler, .user_ctx = NULL};
+
+// Lays out the UTF-8 text of the body on the display and shows it in a single update, lines end at '\n'.
+// "?align=left|center|right" aligns the rows, a comma separated list gives each row of the text its own alignment and
+// the last entry holds for the following rows. "?wrap=word" (default), "?wrap=char" or "?wrap=none" sets how lines
+// longer than the display are broken. The text starts at row "?row=", "?clear=false" keeps the rows it does not cover.
+// "?transition=" and "?duration=" stagger the start of the modules like for /api/frame.
+static esp_err_t api_set_text_handler(httpd_req_t *req)
+{
+    if (!http_isAsyncWorker()) {
+        return http_queueAsync(req, api_set_text_handler);
+    }
+    ESP_LOGI(TAG, "POST request on %s", req->uri);
+    if (http_rejectDuringCalibration(req)) {
+        return ESP_OK;
+    }
+    LARGE_REQUEST_GUARD(req);
+    char query[HTTP_QUERY_LEN];
+    char value[HTTP_QUERY_LEN];
+    bool hasQuery = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK;
+    display_textLayout_t layout = {.wrap = display_wrapWord, .row = 0, .clear = true, .alignCnt = 0};
+    bool badRequest = false;
+    if (hasQuery && httpd_query_key_value(query, "align", value, sizeof(value)) == ESP_OK) {
+        badRequest |= !display_parseAlign(value, &layout);
+    }
+    if (hasQuery && httpd_query_key_value(query, "wrap", value, sizeof(value)) == ESP_OK) {
+        badRequest |= !display_parseWrap(value, &layout);
+    }
+    if (hasQuery && httpd_query_key_value(query, "row", value, sizeof(value)) == ESP_OK) {
+        layout.row = strtoul(value, NULL, 10);
+    }
+    if (hasQuery && httpd_query_key_value(query, "clear", value, sizeof(value)) == ESP_OK) {
+        layout.clear = strcmp(value, "false") != 0 && strcmp(value, "0") != 0;
+    }
+    Transition_t transition = {.type = transition_none};
+    badRequest |= hasQuery && !http_parseTransition(query, &transition);
+    if (badRequest) {
+        httpd_resp_set_status(req, "400 Bad Request");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
+
+    char *text = malloc(req->content_len + 1);
+    if (!text) {
+        ESP_LOGE(TAG, "Failed to allocate memory for the text.");
+        return ESP_FAIL;
+    }
+    size_t received = 0;
+    while (received < req->content_len) {
+        int recv_cnt = httpd_req_recv(req, text + received, req->content_len - received);
+        if (recv_cnt == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        } else if (recv_cnt <= 0) {
+            ESP_LOGE(TAG, "Failed to receive text");
+            free(text);
+            return ESP_FAIL;
+        }
+        received += recv_cnt;
+    }
+    text[received] = '\0';
+
+    // the layout depends on the width of the display and on the characters of each module.
+    if (!display_refreshModuleProperties(DISPLAY_TEXT_PROPERTIES)) {
+        ESP_LOGE(TAG, "Controller has not responded.");
+        free(text);
+        httpd_resp_set_status(req, "500 Internal Server Error");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
+    bool valid = display_setMessage(text, &layout);
+    free(text);
+    if (transition.type != transition_none) {
+        display_setTransition(&transition);
+    }
+
+    if (!model_preformUart()) {
+        ESP_LOGE(TAG, "Controller has not responded.");
+        httpd_resp_set_status(req, "500 Internal Server Error");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
+
+    // characters that are not in the character map of their module are shown as a space.
+    return http_sendEta(req, valid ? "200 OK" : "422 Unprocessable Entity");
+}
+
+static const httpd_uri_t api_set_text_endpoint = {
+    .uri = "/api/text", .method = HTTP_POST, .handler = api_set_text_handler, .user_ctx = NULL};
+
+// Returns the playlist the controller shows in a loop, see flap_playlist.h for its format.
+static esp_err_t api_get_playlist_handler(httpd_req_t *req)
+{
+    ESP_LOGI(TAG, "GET request on %s", req->uri);
+    char *json = playlist_getJson();
     httpd_resp_set_status(req, "200 OK");
     httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-    httpd_resp_set_hdr(req, "Access-Control-Allow-Headers", "Content-Type");
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json ? json : "{\"enabled\":false,\"items\":[]}");
+    free(json);
+    return ESP_OK;
+}
+
+static const httpd_uri_t api_get_playlist_endpoint = {
+    .uri = "/api/playlist", .method = HTTP_GET, .handler = api_get_playlist_handler, .user_ctx = NULL};
+
+// Replaces the playlist, the controller stores it and starts with its first item.
+static esp_err_t api_set_playlist_handler(httpd_req_t *req)
+{
+    ESP_LOGI(TAG, "POST request on %s", req->uri);
+    if (req->content_len > PLAYLIST_MAX_LEN) {
+        httpd_resp_set_status(req, "413 Payload Too Large");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
+    char *json = malloc(req->content_len + 1);
+    if (!json) {
+        ESP_LOGE(TAG, "Failed to allocate memory for the playlist.");
+        return ESP_FAIL;
+    }
+    size_t received = 0;
+    while (received < req->content_len) {
+        int recv_cnt = httpd_req_recv(req, json + received, req->content_len - received);
+        if (recv_cnt == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        } else if (recv_cnt <= 0) {
+            ESP_LOGE(TAG, "Failed to receive playlist");
+            free(json);
+            return ESP_FAIL;
+        }
+        received += recv_cnt;
+    }
+    bool valid = playlist_set(json, received);
+    free(json);
+    httpd_resp_set_status(req, valid ? "200 OK" : "400 Bad Request");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
     httpd_resp_send(req, NULL, 0);
     return ESP_OK;
 }
 
+static const httpd_uri_t api_set_playlist_endpoint = {
+    .uri = "/api/playlist", .method = HTTP_POST, .handler = api_set_playlist_handler, .user_ctx = NULL};
+
+static void http_jsonWriteNumberArray(http_jsonWriter_t *writer, const uint16_t *numbers, size_t cnt)
+{
+    http_jsonWriteRaw(writer, "[", 1);
+    for (size_t i = 0; i < cnt; i++) {
+        if (i) {
+            http_jsonWriteRaw(writer, ",", 1);
+        }
+        http_jsonWriteNumber(writer, numbers[i]);
+    }
+    http_jsonWriteRaw(writer, "]", 1);
+}
+
+// Turns every module one revolution and sets the irLimits from the range each IR sensor has seen, afterwards every
+// module shows the first character of its map. Until the offsets are set the playlist is paused, /api/frame, /api/text
+// and POST /api/modules answer 409 and websocket messages are dropped. A second run while one is in progress answers
+// 409. Answers the result of each module:
+// [{"module":0,"valid":true,"positionsSeen":48,"irMin":[..],"irMax":[..],"irLimits":[..]}]
+static esp_err_t api_calibration_handler(httpd_req_t *req)
+{
+    if (!http_isAsyncWorker()) {
+        return http_queueAsync(req, api_calibration_handler);
+    }
+    ESP_LOGI(TAG, "POST request on %s", req->uri);
+    calibration_result_t *results;
+    size_t cnt;
+    calibration_status_t status = calibration_run(&results, &cnt);
+    if (status == calibration_busy) {
+        ESP_LOGW(TAG, "A calibration is already running");
+        httpd_resp_set_status(req, "409 Conflict");
+        httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    } else if (status != calibration_done) {
+        ESP_LOGE(TAG, "Controller has not responded.");
+        httpd_resp_set_status(req, "500 Internal Server Error");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
+
+    httpd_resp_set_status(req, "200 OK");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_resp_set_type(req, "application/json");
+    http_jsonWriter_t writer = {.send = http_jsonSendChunk, .arg = req, .err = ESP_OK, .sentCnt = 0, .len = 0};
+    http_jsonWriteRaw(&writer, "[", 1);
+    for (size_t i = 0; i < cnt && writer.err == ESP_OK; i++) {
+        if (i) {
+            http_jsonWriteRaw(&writer, ",", 1);
+        }
+        http_jsonWriteRaw(&writer, "{\"module\":", 10);
+        http_jsonWriteNumber(&writer, i);
+        http_jsonWriteRaw(&writer, ",\"valid\":", 9);
+        http_jsonWriteBool(&writer, results[i].valid);
+        http_jsonWriteRaw(&writer, ",\"positionsSeen\":", 17);
+        http_jsonWriteNumber(&writer, results[i].positionsSeen);
+        http_jsonWriteRaw(&writer, ",\"irMin\":", 9);
+        http_jsonWriteNumberArray(&writer, results[i].irMin, MODULE_IR_SENSOR_CNT);
+        http_jsonWriteRaw(&writer, ",\"irMax\":", 9);
+        http_jsonWriteNumberArray(&writer, results[i].irMax, MODULE_IR_SENSOR_CNT);
+        http_jsonWriteRaw(&writer, ",\"irLimits\":", 12);
+        http_jsonWriteNumberArray(&writer, results[i].irLimits, MODULE_IR_SENSOR_CNT);
+        http_jsonWriteRaw(&writer, "}", 1);
+    }
+    http_jsonWriteRaw(&writer, "]", 1);
+    http_jsonFinish(&writer);
+    free(results);
+    return ESP_OK;
+}
+
+static const httpd_uri_t api_calibration_endpoint = {
+    .uri = "/api/calibration", .method = HTTP_POST, .handler = api_calibration_handler, .user_ctx = NULL};
+
+// The body holds the UTF-8 character each module shows in chain order after a calibration run. The offsets of all
+// modules are corrected in a single pass, after which every module shows the first character of its map again.
+static esp_err_t api_calibration_offset_handler(httpd_req_t *req)
+{
+    if (!http_isAsyncWorker()) {
+        return http_queueAsync(req, api_calibration_offset_handler);
+    }
+    ESP_LOGI(TAG, "POST request on %s", req->uri);
+    LARGE_REQUEST_GUARD(req);
+    char *shown = malloc(req->content_len + 1);
+    if (!shown) {
+        ESP_LOGE(TAG, "Failed to allocate memory for the characters.");
+        return ESP_FAIL;
+    }
+    size_t received = 0;
+    while (received < req->content_len) {
+        int recv_cnt = httpd_req_recv(req, shown + received, req->content_len - received);
+        if (recv_cnt == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        } else if (recv_cnt <= 0) {
+            ESP_LOGE(TAG, "Failed to receive characters");
+            free(shown);
+            return ESP_FAIL;
+        }
+        received += recv_cnt;
+    }
+    shown[received] = '\0';
+
+    bool valid;
+    bool ok = calibration_setOffsets(shown, &valid);
+    free(shown);
+    if (!ok) {
+        ESP_LOGE(TAG, "Controller has not responded.");
+        httpd_resp_set_status(req, "500 Internal Server Error");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
+    return http_sendEta(req, valid ? "200 OK" : "422 Unprocessable Entity");
+}
+
+static const httpd_uri_t api_calibration_offset_endpoint = {
+    .uri = "/api/calibration/offset", .method = HTTP_POST, .handler = api_calibration_offset_handler, .user_ctx = NULL};
+
+// Returns the geometry of the display, each column lists its modules from top to bottom:
+// {"width":2,"height":3,"columns":[[0,1,2],[3,4,5]]}
+static esp_err_t api_get_display_handler(httpd_req_t *req)
+{
+    if (!http_isAsyncWorker()) {
+        return http_queueAsync(req, api_get_display_handler);
+    }
+    ESP_LOGI(TAG, "GET request on %s", req->uri);
+    ulTaskNotifyTake(true, 0);
+    if (display_getStaleModuleProperties(1 << columnEnd_property)) {
+        display_requestModuleProperty(columnEnd_property);
+        model_preformUart();
+    }
+
+    // the geometry is copied, so it is written to the client without holding the frame lock.
+    display_lock();
+    size_t width = display_getWidth();
+    size_t height = display_getHeight();
+    int16_t *moduleAt = malloc(width * height * sizeof(int16_t));
+    for (size_t x = 0; moduleAt && x < width; x++) {
+        for (size_t y = 0; y < height; y++) {
+            moduleAt[x * height + y] = display_getModuleIndex(x, y);
+        }
+    }
+    display_unlock();
+    if (!moduleAt && width && height) {
+        ESP_LOGE(TAG, "Failed to allocate memory for the display geometry.");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_status(req, "200 OK");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_resp_set_type(req, "application/json");
+    http_jsonWriter_t writer = {.send = http_jsonSendChunk, .arg = req, .err = ESP_OK, .sentCnt = 0, .len = 0};
+    http_jsonWriteRaw(&writer, "{\"width\":", 9);
+    http_jsonWriteNumber(&writer, width);
+    http_jsonWriteRaw(&writer, ",\"height\":", 10);
+    http_jsonWriteNumber(&writer, height);
+    http_jsonWriteRaw(&writer, ",\"columns\":[", 12);
+    for (size_t x = 0; x < width; x++) {
+        http_jsonWriteRaw(&writer, x ? ",[" : "[", x ? 2 : 1);
+        for (size_t y = 0; y < height && moduleAt[x * height + y] >= 0; y++) {
+            if (y) {
+                http_jsonWriteRaw(&writer, ",", 1);
+            }
+            http_jsonWriteNumber(&writer, moduleAt[x * height + y]);
+        }
+        http_jsonWriteRaw(&writer, "]", 1);
+    }
+    free(moduleAt);
+    http_jsonWriteRaw(&writer, "]}", 2);
+    http_jsonFinish(&writer);
+    return ESP_OK;
+}
+
+static const httpd_uri_t api_get_display_endpoint = {
+    .uri = "/api/display", .method = HTTP_GET, .handler = api_get_display_handler, .user_ctx = NULL};
+static void ws_removeClient(int fd)
+{
+    xSemaphoreTake(wsLock, portMAX_DELAY);
+    for (int i = 0; i < MAX_WS_CONNECTIONS; i++) {
+        if (wsClients[i] == fd) {
+            wsClients[i] = -1;
+        }
+    }
+    xSemaphoreGive(wsLock);
+}
+
+static bool ws_addClient(int fd)
+{
+    bool added = false;
+    xSemaphoreTake(wsLock, portMAX_DELAY);
+    for (int i = 0; i < MAX_WS_CONNECTIONS && !added; i++) {
+        if (wsClients[i] == -1 || wsClients[i] == fd) {
+            wsClients[i] = fd;
+            added = true;
+        }
+    }
+    xSemaphoreGive(wsLock);
+    return added;
+}
+
+static esp_err_t ws_sendFrame(int fd, httpd_ws_frame_t *frame)
+{
+    if (httpd_ws_get_fd_info(server, fd) != HTTPD_WS_CLIENT_WEBSOCKET) {
+        return ESP_FAIL;
+    }
+    return httpd_ws_send_frame_async(server, fd, frame);
+}
+
+// Sends the writer output as a fragmented text message, to a single client when arg holds its socket or to all clients
+// when arg is -1.
+static esp_err_t ws_jsonSend(http_jsonWriter_t *writer, bool final)
+{
+    httpd_ws_frame_t frame = {
+        .type = writer->sentCnt ? HTTPD_WS_TYPE_CONTINUE : HTTPD_WS_TYPE_TEXT,
+        .fragmented = !(final && !writer->sentCnt),
+        .final = final,
+        .payload = (uint8_t *)writer->buf,
+        .len = writer->len,
+    };
+    int fd = (int)(intptr_t)writer->arg;
+    if (fd >= 0) {
+        return ws_sendFrame(fd, &frame);
+    }
+    xSemaphoreTake(wsLock, portMAX_DELAY);
+    for (int i = 0; i < MAX_WS_CONNECTIONS; i++) {
+        if (wsClients[i] != -1 && ws_sendFrame(wsClients[i], &frame) != ESP_OK) {
+            ESP_LOGI(TAG, "Websocket client %d disconnected", wsClients[i]);
+            wsClients[i] = -1;
+        }
+    }
+    xSemaphoreGive(wsLock);
+    return ESP_OK;
+}
+
+static bool ws_hasClients()
+{
+    bool hasClients = false;
+    xSemaphoreTake(wsLock, portMAX_DELAY);
+    for (int i = 0; i < MAX_WS_CONNECTIONS; i++) {
+        hasClients |= wsClients[i] != -1;
+    }
+    xSemaphoreGive(wsLock);
+    return hasClients;
+}
+
+esp_err_t trigger_async_send(char *json_data)
+{
+    http_jsonWriter_t writer = {.send = ws_jsonSend, .arg = (void *)-1, .err = ESP_OK, .sentCnt = 0, .len = 0};
+    http_jsonWriteRaw(&writer, json_data, strlen(json_data));
+    http_jsonFinish(&writer);
+    return writer.err;
+}
+
+// A websocket message built while the frame lock is held, it is sent by the http server task after the unlock.
+typedef struct {
+    char *data;
+    size_t len;
+    int fd; // socket of the client, -1 sends the message to all clients.
+} ws_message_t;
+
+static esp_err_t ws_jsonCollect(http_jsonWriter_t *writer, bool final)
+{
+    ws_message_t *message = writer->arg;
+    if (!writer->len) {
+        return ESP_OK;
+    }
+    char *data = realloc(message->data, message->len + writer->len);
+    if (!data) {
+        ESP_LOGE(TAG, "Failed to allocate memory for a websocket message");
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(data + message->len, writer->buf, writer->len);
+    message->data = data;
+    message->len += writer->len;
+    return ESP_OK;
+}
+
+static void ws_messageDelete(ws_message_t *message)
+{
+    free(message->data);
+    free(message);
+}
+
+static void ws_sendMessage(void *arg)
+{
+    ws_message_t *message = arg;
+    http_jsonWriter_t writer = {
+        .send = ws_jsonSend, .arg = (void *)(intptr_t)message->fd, .err = ESP_OK, .sentCnt = 0, .len = 0};
+    http_jsonWriteRaw(&writer, message->data, message->len);
+    http_jsonFinish(&writer);
+    ws_messageDelete(message);
+}
+
+// Queues a message that is complete in writer. The work queue of the server keeps the messages in order, so these are
+// queued before the frame lock is released.
+static void ws_queueMessage(http_jsonWriter_t *writer)
+{
+    ws_message_t *message = writer->arg;
+    http_jsonFinish(writer);
+    if (writer->err != ESP_OK || httpd_queue_work(server, ws_sendMessage, message) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to queue a websocket message");
+        ws_messageDelete(message);
+    }
+}
+
+void http_publishModuleChanges()
+{
+    if (!server) {
+        return;
+    }
+    uint64_t publishedProperties = 0;
+    for (moduleProperty_t p = no_property + 1; p < end_of_properties; p++) {
+        if (http_modulePropertyHandlers[p].toJson) {
+            publishedProperties |= (1 << p);
+        }
+    }
+
+    // the delta is an array of module objects holding only the properties that have changed.
+    ws_message_t *message = ws_hasClients() ? calloc(1, sizeof(ws_message_t)) : NULL;
+    bool hasChanges = false;
+    http_jsonWriter_t writer = {.send = ws_jsonCollect, .arg = message, .err = ESP_OK, .sentCnt = 0, .len = 0};
+    if (message) {
+        message->fd = -1;
+        http_jsonWriteRaw(&writer, "[", 1);
+    }
+    display_lock();
+    for (size_t i = 0; i < display_getSize(); i++) {
+        module_t *module = display_getModule(i);
+        uint64_t changedProperties = module->changedProperties & publishedProperties;
+        if (changedProperties & (1 << characterMap_property)) {
+            changedProperties |= (1 << character_property) & publishedProperties; // the index refers to a new map.
+        }
+        module->changedProperties = 0;
+        if (changedProperties && message) {
+            if (hasChanges) {
+                http_jsonWriteRaw(&writer, ",", 1);
+            }
+            http_jsonWriteModule(&writer, i, module, changedProperties);
+            hasChanges = true;
+        }
+    }
+    if (hasChanges) {
+        http_jsonWriteRaw(&writer, "]", 1);
+        ws_queueMessage(&writer);
+    } else if (message) {
+        ws_messageDelete(message);
+    }
+    display_unlock();
+}
+
+// Websocket clients receive the cached state of the display when they connect and a delta of the changed properties
+// after every model pass. Text messages in the format of POST /api/modules and binary messages holding a character
+// index per module are written to the display.
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+    int fd = httpd_req_to_sockfd(req);
+    if (req->method == HTTP_GET) {
+        if (!ws_addClient(fd)) {
+            ESP_LOGE(TAG, "Too many websocket clients");
+            return ESP_FAIL;
+        }
+        ESP_LOGI(TAG, "Websocket client %d connected", fd);
+        ws_message_t *message = calloc(1, sizeof(ws_message_t));
+        if (!message) {
+            ESP_LOGE(TAG, "Failed to allocate memory for a websocket message");
+            return ESP_FAIL;
+        }
+        message->fd = fd;
+        http_jsonWriter_t writer = {.send = ws_jsonCollect, .arg = message, .err = ESP_OK, .sentCnt = 0, .len = 0};
+        http_jsonWriteRaw(&writer, "[", 1);
+        display_lock();
+        for (size_t i = 0; i < display_getSize() && writer.err == ESP_OK; i++) {
+            if (i) {
+                http_jsonWriteRaw(&writer, ",", 1);
+            }
+            http_jsonWriteModule(&writer, i, display_getBackModule(i), ~0ULL);
+        }
+        http_jsonWriteRaw(&writer, "]", 1);
+        ws_queueMessage(&writer); // queued behind the deltas built before this snapshot.
+        display_unlock();
+        return ESP_OK;
+    }
+
+    httpd_ws_frame_t frame = {0};
+    if (httpd_ws_recv_frame(req, &frame, 0) != ESP_OK) {
+        ws_removeClient(fd);
+        return ESP_FAIL;
+    }
+    if (frame.type == HTTPD_WS_TYPE_CLOSE) {
+        ws_removeClient(fd);
+        return ESP_OK;
+    } else if (!frame.len || (frame.type != HTTPD_WS_TYPE_TEXT && frame.type != HTTPD_WS_TYPE_BINARY)) {
+        return ESP_OK;
+    } else if (frame.len > WS_MAX_MESSAGE_LEN) {
+        ESP_LOGE(TAG, "Websocket message of %d bytes is too large", frame.len);
+        return ESP_FAIL;
+    }
+    frame.payload = malloc(frame.len);
+    if (!frame.payload) {
+        ESP_LOGE(TAG, "Failed to allocate memory for websocket message");
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = httpd_ws_recv_frame(req, &frame, frame.len);
+    if (err == ESP_OK && calibration_isActive()) {
+        ESP_LOGW(TAG, "Dropped a websocket message during the calibration");
+    } else if (err == ESP_OK && frame.type == HTTPD_WS_TYPE_TEXT) {
+        http_moduleParser_t parser = {.depth = 0};
+        jsonStream_t stream;
+        jsonStream_init(&stream, http_moduleParserCallback, &parser);
+        http_moduleParserReset(&parser);
+        if (!jsonStream_feed(&stream, (char *)frame.payload, frame.len) || !jsonStream_isDone(&stream)) {
+            ESP_LOGE(TAG, "Failed to parse websocket message");
+        }
+        http_moduleParserReset(&parser);
+    } else if (err == ESP_OK) {
+        http_setFrameIndices(frame.payload, frame.len, 0);
+    }
+    free(frame.payload);
+    // the result is published to all clients once the model has processed it.
+    model_requestUpdate();
+    return err;
+}
+
+static const httpd_uri_t ws = {
+    .uri = "/ws", .method = HTTP_GET, .handler = ws_handler, .user_ctx = NULL, .is_websocket = true};
+
 static const httpd_uri_t api_get_module_endpoint = {
     .uri = "/api/modules", .method = HTTP_GET, .handler = api_get_http_modulePropertyHandlers, .user_ctx = NULL};
 
@@ -440,6 +1510,12 @@ static const httpd_uri_t wifi_ap_post = {
 
 void flap_init_webserver()
 {
+    wsLock = xSemaphoreCreateMutex();
+    asyncRequestQueue = xQueueCreate(HTTP_ASYNC_QUEUE_LEN, sizeof(http_asyncRequest_t));
+    for (int i = 0; i < HTTP_ASYNC_WORKER_CNT; i++) {
+        xTaskCreate(http_asyncWorkerTask, "http worker", 4096 + MAX_HTTP_BODY_SIZE, (void *)(intptr_t)i, 5,
+                    &asyncWorkers[i]);
+    }
     ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &http_server_connect_handler, NULL));
     ESP_ERROR_CHECK(
         esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &http_server_disconnect_handler, NULL));
@@ -456,6 +1532,9 @@ httpd_handle_t flap_start_webserver(void)
     // config.stack_size = 8000;
     // Start the httpd server
     ESP_LOGI(TAG, "Starting server on port: '%d'", config.server_port);
+    for (int i = 0; i < MAX_WS_CONNECTIONS; i++) {
+        wsClients[i] = -1;
+    }
     if (httpd_start(&server, &config) == ESP_OK) {
         // Set URI handlers
         ESP_LOGI(TAG, "Registering URI handlers");
@@ -468,7 +1547,14 @@ httpd_handle_t flap_start_webserver(void)
         httpd_register_uri_handler(server, &api_get_module_endpoint);
         httpd_register_uri_handler(server, &api_set_module_endpoint);
         httpd_register_uri_handler(server, &api_option_module_endpoint);
-        // httpd_register_uri_handler(server, &ws);
+        httpd_register_uri_handler(server, &api_set_frame_endpoint);
+        httpd_register_uri_handler(server, &api_set_text_endpoint);
+        httpd_register_uri_handler(server, &api_get_playlist_endpoint);
+        httpd_register_uri_handler(server, &api_set_playlist_endpoint);
+        httpd_register_uri_handler(server, &api_calibration_endpoint);
+        httpd_register_uri_handler(server, &api_calibration_offset_endpoint);
+        httpd_register_uri_handler(server, &api_get_display_endpoint);
+        httpd_register_uri_handler(server, &ws);
         http_moduleEndpointInit();
         return server;
     }
@@ -63,4 +63,45 @@ esp_err_t flap_nvs_set_string(char *field_key, char *field_value)
         return ESP_OK;
     }
     return ESP_FAIL;
+}
+
+esp_err_t flap_nvs_get_blob(char *field_key, void **field_value, size_t *field_len)
+{
+    if (nvs_open("nvs", NVS_READWRITE, &nvs_ctx) == ESP_OK){
+        if (nvs_get_blob(nvs_ctx, field_key, NULL, field_len) != ESP_OK){
+            ESP_LOGI(TAG,"Key %s not found",field_key);
+            nvs_close(nvs_ctx);
+            return ESP_FAIL;
+        }
+        *field_value = malloc(*field_len);
+        if (!*field_value || nvs_get_blob(nvs_ctx, field_key, *field_value, field_len) != ESP_OK){
+            ESP_LOGE(TAG,"Failed to read %s",field_key);
+            free(*field_value);
+            *field_value = NULL;
+            nvs_close(nvs_ctx);
+            return ESP_FAIL;
+        }
+        nvs_close(nvs_ctx);
+        return ESP_OK;
+    }
+    return ESP_FAIL;
+}
+
+esp_err_t flap_nvs_set_blob(char *field_key, void *field_value, size_t field_len)
+{
+    if(nvs_open("nvs", NVS_READWRITE, &nvs_ctx) == ESP_OK){
+        if (nvs_set_blob(nvs_ctx, field_key, field_value, field_len) != ESP_OK){
+            ESP_LOGE(TAG, "Failed to store %s",field_key);
+            nvs_close(nvs_ctx);
+            return ESP_FAIL;
+        }
+        if (nvs_commit(nvs_ctx) != ESP_OK){
+            ESP_LOGI(TAG, "Failed to commit data to NVS");
+            nvs_close(nvs_ctx);
+            return ESP_FAIL;
+        }
+        nvs_close(nvs_ctx);
+        return ESP_OK;
+    }
+    return ESP_FAIL;
 }
\ No newline at end of file
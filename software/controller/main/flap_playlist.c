@@ -0,0 +1,277 @@
+#include "flap_playlist.h"
+
+#include <string.h>
+
+#include "cJSON.h"
+
+#include "flap_nvs.h"
+
+static const char *TAG = "[PLAYLIST]";
+
+// Character index of each module for the next item, resolved while the current item is shown.
+typedef struct {
+    int16_t *indices;
+    size_t cnt;
+    uint32_t holdMs;
+    Transition_t transition;
+} playlist_frame_t;
+
+static struct {
+    TaskHandle_t task;
+    SemaphoreHandle_t lock;    // guards the playlist.
+    SemaphoreHandle_t changed; // given when a new playlist has been set.
+    SemaphoreHandle_t show;    // held while an item is written to the display.
+    playlist_t *playlist;
+    bool paused;               // guarded by lock.
+} ctx;
+
+static void playlist_delete(playlist_t *playlist)
+{
+    if (!playlist) {
+        return;
+    }
+    for (size_t i = 0; i < playlist->itemCnt; i++) {
+        free(playlist->item[i].content);
+    }
+    free(playlist->item);
+    free(playlist->json);
+    free(playlist);
+}
+
+static bool playlist_parseItem(cJSON *entry, playlist_item_t *item)
+{
+    cJSON *hold = cJSON_GetObjectItemCaseSensitive(entry, "hold");
+    cJSON *text = cJSON_GetObjectItemCaseSensitive(entry, "text");
+    cJSON *frame = cJSON_GetObjectItemCaseSensitive(entry, "frame");
+    if (!cJSON_IsNumber(hold) || hold->valuedouble < PLAYLIST_MIN_HOLD_MS || hold->valuedouble > UINT32_MAX ||
+        cJSON_IsString(text) == cJSON_IsString(frame)) {
+        return false;
+    }
+    item->type = cJSON_IsString(text) ? playlist_itemText : playlist_itemFrame;
+    item->holdMs = hold->valuedouble;
+    item->layout = (display_textLayout_t){.wrap = display_wrapWord, .row = 0, .clear = true, .alignCnt = 0};
+    cJSON *align = cJSON_GetObjectItemCaseSensitive(entry, "align");
+    cJSON *wrap = cJSON_GetObjectItemCaseSensitive(entry, "wrap");
+    cJSON *row = cJSON_GetObjectItemCaseSensitive(entry, "row");
+    cJSON *clear = cJSON_GetObjectItemCaseSensitive(entry, "clear");
+    cJSON *transition = cJSON_GetObjectItemCaseSensitive(entry, "transition");
+    cJSON *duration = cJSON_GetObjectItemCaseSensitive(entry, "duration");
+    item->transition = (Transition_t){.type = transition_none, .durationMs = 0};
+    if ((align && (!cJSON_IsString(align) || !display_parseAlign(align->valuestring, &item->layout))) ||
+        (wrap && (!cJSON_IsString(wrap) || !display_parseWrap(wrap->valuestring, &item->layout))) ||
+        (row && (!cJSON_IsNumber(row) || row->valueint < 0)) || (clear && !cJSON_IsBool(clear)) ||
+        (transition && (!cJSON_IsString(transition) ||
+                        !display_parseTransition(transition->valuestring, &item->transition))) ||
+        (duration && (!cJSON_IsNumber(duration) || duration->valueint < 0 || duration->valueint > UINT16_MAX))) {
+        return false;
+    }
+    item->transition.durationMs = duration ? duration->valueint : 0;
+    item->layout.row = row ? row->valueint : 0;
+    item->layout.clear = !clear || cJSON_IsTrue(clear);
+    item->content = strdup(cJSON_IsString(text) ? text->valuestring : frame->valuestring);
+    return item->content != NULL;
+}
+
+static playlist_t *playlist_parse(const char *json, size_t len)
+{
+    cJSON *root = cJSON_ParseWithLength(json, len);
+    cJSON *items = cJSON_GetObjectItemCaseSensitive(root, "items");
+    cJSON *enabled = cJSON_GetObjectItemCaseSensitive(root, "enabled");
+    playlist_t *playlist = NULL;
+    if (cJSON_IsArray(items) && (!enabled || cJSON_IsBool(enabled))) {
+        playlist = calloc(1, sizeof(playlist_t));
+    }
+    if (playlist) {
+        playlist->enabled = !enabled || cJSON_IsTrue(enabled);
+        playlist->item = calloc(cJSON_GetArraySize(items) + 1, sizeof(playlist_item_t));
+        playlist->json = strndup(json, len);
+    }
+    bool valid = playlist && playlist->item && playlist->json;
+    cJSON *entry;
+    cJSON_ArrayForEach(entry, items)
+    {
+        if (!valid) {
+            break;
+        }
+        valid = playlist_parseItem(entry, &playlist->item[playlist->itemCnt]);
+        if (!valid) {
+            free(playlist->item[playlist->itemCnt].content);
+            break;
+        }
+        playlist->itemCnt++;
+    }
+    cJSON_Delete(root);
+    if (!valid) {
+        ESP_LOGE(TAG, "Invalid playlist");
+        playlist_delete(playlist);
+        return NULL;
+    }
+    return playlist;
+}
+
+static void playlist_replace(playlist_t *playlist)
+{
+    xSemaphoreTake(ctx.lock, portMAX_DELAY);
+    playlist_t *old = ctx.playlist;
+    ctx.playlist = playlist;
+    xSemaphoreGive(ctx.lock);
+    playlist_delete(old);
+    xSemaphoreGive(ctx.changed);
+}
+
+bool playlist_set(const char *json, size_t len)
+{
+    playlist_t *playlist = playlist_parse(json, len);
+    if (!playlist) {
+        return false;
+    }
+    ESP_LOGI(TAG, "New playlist of %d items", playlist->itemCnt);
+    if (flap_nvs_set_blob(PLAYLIST_NVS_KEY, playlist->json, len) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to store the playlist, it is lost on a reboot");
+    }
+    playlist_replace(playlist);
+    return true;
+}
+
+void playlist_pause(void)
+{
+    xSemaphoreTake(ctx.lock, portMAX_DELAY);
+    ctx.paused = true;
+    xSemaphoreGive(ctx.lock);
+    // an item that is being written to the display is finished first.
+    xSemaphoreTake(ctx.show, portMAX_DELAY);
+    xSemaphoreGive(ctx.show);
+}
+
+void playlist_resume(void)
+{
+    xSemaphoreTake(ctx.lock, portMAX_DELAY);
+    ctx.paused = false;
+    xSemaphoreGive(ctx.lock);
+    xSemaphoreGive(ctx.changed);
+}
+
+char *playlist_getJson(void)
+{
+    xSemaphoreTake(ctx.lock, portMAX_DELAY);
+    char *json = ctx.playlist ? strdup(ctx.playlist->json) : NULL;
+    xSemaphoreGive(ctx.lock);
+    return json;
+}
+
+// Resolves item itemIndex to the character index of each module, so showing it only writes these into the back frame.
+// Returns false if there is nothing to show.
+static bool playlist_prefetch(size_t itemIndex, playlist_frame_t *frame)
+{
+    xSemaphoreTake(ctx.lock, portMAX_DELAY);
+    playlist_t *playlist = ctx.playlist;
+    if (ctx.paused || !playlist || !playlist->enabled || !playlist->itemCnt) {
+        xSemaphoreGive(ctx.lock);
+        return false;
+    }
+    playlist_item_t *item = &playlist->item[itemIndex % playlist->itemCnt];
+    display_lock(); // the size and characterMaps of the display must not change during the layout.
+    size_t size = display_getSize();
+    if (!size) {
+        display_unlock(); // the chain has not been discovered yet.
+        xSemaphoreGive(ctx.lock);
+        return false;
+    }
+    if (frame->cnt != size) {
+        int16_t *indices = realloc(frame->indices, size * sizeof(int16_t));
+        if (!indices) {
+            ESP_LOGE(TAG, "Failed to allocate memory for the next frame.");
+            display_unlock();
+            xSemaphoreGive(ctx.lock);
+            return false;
+        }
+        frame->indices = indices;
+        frame->cnt = size;
+    }
+    if (item->type == playlist_itemText) {
+        display_layoutMessage(item->content, &item->layout, frame->indices);
+    } else {
+        const char *str = item->content;
+        for (size_t i = 0; i < size; i++) {
+            char character[4];
+            size_t n = utf8_getCharacter(str, character);
+            str += n;
+            module_t *backModule = display_getBackModule(i);
+            frame->indices[i] =
+                n ? characterMap_getNearestIndex(backModule->characterMap, character, backModule->characterIndex) : -1;
+        }
+    }
+    display_unlock();
+    frame->holdMs = item->holdMs;
+    frame->transition = item->transition;
+    xSemaphoreGive(ctx.lock);
+    return true;
+}
+
+/*
+ * Shows the items of the playlist in a loop. The next item is resolved while the current one is shown, so at its
+ * deadline only the indices are copied into the back frame before the model pass starts. Deadlines follow from the
+ * previous deadline rather than from the end of the model pass, so the time the chain takes does not add up.
+ */
+static void playlist_task(void *arg)
+{
+    playlist_frame_t frame = {.indices = NULL, .cnt = 0, .holdMs = 0};
+    size_t next = 0;
+    TickType_t shownTick = xTaskGetTickCount();
+    TickType_t hold = 0;
+    while (true) {
+        display_refreshModuleProperties(DISPLAY_TEXT_PROPERTIES);
+        if (!playlist_prefetch(next, &frame)) {
+            // an empty display is looked at again, otherwise only a new playlist changes anything.
+            TickType_t wait = display_getSize() ? portMAX_DELAY : pdMS_TO_TICKS(PLAYLIST_NO_DISPLAY_RETRY_MS);
+            xSemaphoreTake(ctx.changed, wait);
+            next = 0;
+            hold = 0;
+            continue;
+        }
+        TickType_t elapsed = xTaskGetTickCount() - shownTick;
+        if (xSemaphoreTake(ctx.changed, elapsed < hold ? hold - elapsed : 0) == pdTRUE) {
+            next = 0; // a new playlist starts right away.
+            hold = 0;
+            continue;
+        }
+        TickType_t now = xTaskGetTickCount();
+        TickType_t deadline = shownTick + hold;
+        shownTick = now - deadline <= pdMS_TO_TICKS(PLAYLIST_MAX_LAG_MS) ? deadline : now;
+        hold = pdMS_TO_TICKS(frame.holdMs);
+        if (frame.cnt != display_getSize() && !playlist_prefetch(next, &frame)) {
+            continue; // the display changed while the previous item was shown.
+        }
+        xSemaphoreTake(ctx.show, portMAX_DELAY);
+        xSemaphoreTake(ctx.lock, portMAX_DELAY);
+        bool paused = ctx.paused;
+        xSemaphoreGive(ctx.lock);
+        if (paused) {
+            xSemaphoreGive(ctx.show);
+            continue;
+        }
+        display_setCharacterIndices(frame.indices, frame.cnt);
+        if (frame.transition.type != transition_none) {
+            display_setTransition(&frame.transition);
+        }
+        if (!model_preformUart()) {
+            ESP_LOGE(TAG, "Controller has not responded.");
+        }
+        xSemaphoreGive(ctx.show);
+        next++;
+    }
+}
+
+void flap_playlist_init(void)
+{
+    ctx.lock = xSemaphoreCreateMutex();
+    ctx.changed = xSemaphoreCreateBinary();
+    ctx.show = xSemaphoreCreateMutex();
+    char *json = NULL;
+    size_t len = 0;
+    if (flap_nvs_get_blob(PLAYLIST_NVS_KEY, (void **)&json, &len) == ESP_OK) {
+        ctx.playlist = playlist_parse(json, len);
+        free(json);
+    }
+    xTaskCreate(playlist_task, "playlist task", 4096, NULL, 8, &ctx.task);
+}
@@ -2,28 +2,112 @@
 
 static const char *TAG = "[SOCK]";
 
-static QueueHandle_t flap_socket_queue;
 static TaskHandle_t flap_socket_taskHandle;
 static vprintf_like_t original_log_func; 
 
-int socket_log_func(const char *fmt, va_list args) {   
-    char *log_msg;
-    int ret = vasprintf(&log_msg,fmt,args);
-    if(ret<0){
-        printf("couldn't allocate memory for message...\n");
-    }else{
-	    if(xQueueSend(flap_socket_queue,&log_msg,50/portTICK_PERIOD_MS) != pdTRUE){
-            free(log_msg);
+/*
+ * Log lines are passed to the socket task through a lock-free byte ring, so logging never allocates or blocks. A
+ * record is a header word followed by the line, padded to a multiple of 4 bytes. Writers reserve space by advancing
+ * head and publish a record by storing its header. The socket task consumes committed records in order and zeroes
+ * them, so a reserved record always starts with a zero header until it is committed.
+ */
+#define LOG_RECORD_COMMITTED (1u << 31)
+#define LOG_RECORD_PADDING   (1u << 30)
+#define LOG_RECORD_LEN_MASK  0xffff
+
+static uint8_t log_ring[LOG_RING_LEN] __attribute__((aligned(4)));
+static atomic_uint log_head;
+static atomic_uint log_tail;
+static atomic_uint log_dropped;
+
+static inline uint32_t log_recordSpan(uint32_t len)
+{
+    return sizeof(uint32_t) + ((len + 3) & ~3u);
+}
+
+static void log_write(const char *data, uint32_t len)
+{
+    uint32_t span = log_recordSpan(len);
+    uint32_t head, offset, padding;
+    do {
+        head = atomic_load_explicit(&log_head, memory_order_relaxed);
+        offset = head & (LOG_RING_LEN - 1);
+        // records do not wrap around, the end of the ring is skipped with a padding record.
+        padding = offset + span > LOG_RING_LEN ? LOG_RING_LEN - offset : 0;
+        if (head + padding + span - atomic_load_explicit(&log_tail, memory_order_acquire) > LOG_RING_LEN) {
+            atomic_fetch_add_explicit(&log_dropped, len, memory_order_relaxed);
+            return;
         }
+    } while (!atomic_compare_exchange_weak_explicit(&log_head, &head, head + padding + span, memory_order_acquire,
+                                                    memory_order_relaxed));
+    if (padding) {
+        atomic_store_explicit((atomic_uint *)&log_ring[offset], LOG_RECORD_COMMITTED | LOG_RECORD_PADDING | padding,
+                              memory_order_release);
+        offset = 0;
+    }
+    memcpy(&log_ring[offset + sizeof(uint32_t)], data, len);
+    atomic_store_explicit((atomic_uint *)&log_ring[offset], LOG_RECORD_COMMITTED | len, memory_order_release);
+}
+
+// Copies committed records into buf and releases them. Returns the number of bytes copied.
+static size_t log_read(char *buf, size_t size)
+{
+    size_t len = 0;
+    uint32_t tail = atomic_load_explicit(&log_tail, memory_order_relaxed);
+    while (1) {
+        uint32_t offset = tail & (LOG_RING_LEN - 1);
+        uint32_t header = atomic_load_explicit((atomic_uint *)&log_ring[offset], memory_order_acquire);
+        if (!(header & LOG_RECORD_COMMITTED)) {
+            break;
+        }
+        uint32_t recordLen = header & LOG_RECORD_LEN_MASK;
+        uint32_t span = header & LOG_RECORD_PADDING ? recordLen : log_recordSpan(recordLen);
+        if (!(header & LOG_RECORD_PADDING)) {
+            if (len + recordLen > size) {
+                break;
+            }
+            memcpy(buf + len, &log_ring[offset + sizeof(uint32_t)], recordLen);
+            len += recordLen;
+        }
+        memset(&log_ring[offset], 0, span);
+        tail += span;
+        atomic_store_explicit(&log_tail, tail, memory_order_release);
+    }
+    return len;
+}
+
+int socket_log_func(const char *fmt, va_list args) {   
+    char line[LOG_LINE_LEN];
+    int ret = vsnprintf(line, sizeof(line), fmt, args);
+    if (ret > 0) {
+        log_write(line, ret < sizeof(line) ? ret : sizeof(line) - 1);
     }
     return ret;
 }
 
+static bool flap_send(const int sock, const char *data, size_t len)
+{
+    while (len > 0) {
+        int written = send(sock, data, len, 0);
+        if (written < 0) {
+            if (errno == EAGAIN) {
+                vTaskDelay(10 / portTICK_PERIOD_MS);
+                continue;
+            }
+            printf("Error occurred during sending: errno %d\n", errno);
+            return false;
+        }
+        data += written;
+        len -= written;
+    }
+    return true;
+}
+
 static void flap_log_loop(const int sock)
 {
     int len;
     char rx_buffer[128];
-    char *tx_buffer;
+    char tx_buffer[LOG_BATCH_LEN];
     do {
         len = recv(sock, rx_buffer, sizeof(rx_buffer) - 1, MSG_DONTWAIT);
         if (len < 0) {
@@ -31,21 +115,20 @@ static void flap_log_loop(const int sock)
         } else if (len == 0) {
             printf("Connection closed\n");
         } 
-        if (xQueueReceive(flap_socket_queue, &tx_buffer,  50/portTICK_PERIOD_MS)){
-            len = strlen(tx_buffer);
-            int to_write = len;
-            printf(tx_buffer);
-            while (to_write > 0) {
-                int written = send(sock, tx_buffer + (len - to_write), to_write, 0);
-                if (written < 0) {
-                    printf("Error occurred during sending: errno %d\n", errno);
-                    to_write = 0;
-                }
-                to_write -= written;
+        uint32_t dropped = atomic_exchange_explicit(&log_dropped, 0, memory_order_relaxed);
+        if (dropped) {
+            int n = snprintf(tx_buffer, sizeof(tx_buffer), "[%lu log bytes dropped]\n", (unsigned long)dropped);
+            flap_send(sock, tx_buffer, n);
+        }
+        size_t tx_len = log_read(tx_buffer, sizeof(tx_buffer));
+        if (tx_len) {
+            fwrite(tx_buffer, 1, tx_len, stdout);
+            if (!flap_send(sock, tx_buffer, tx_len)) {
+                len = 0;
             }
-            free(tx_buffer);
+        } else {
+            vTaskDelay(LOG_DRAIN_PERIOD_MS / portTICK_PERIOD_MS);
         }
-
     } while (len != 0);
 }
 
@@ -132,8 +215,6 @@ CLEAN_UP:
 
 void flap_init_socket_server(void)
 {
-    flap_socket_queue = xQueueCreate(10, sizeof(char *));
-    configASSERT(flap_socket_queue);
     xTaskCreate(tcp_server_task, "socket_server", 4096, (void*)AF_INET, 5, &flap_socket_taskHandle);
     configASSERT(flap_socket_taskHandle);
 }
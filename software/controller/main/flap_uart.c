@@ -1,17 +1,68 @@
 #include "flap_uart.h"
-#include "flap_http_server.h"
+
+#include <stdatomic.h>
 
 static const char *TAG = "[UART]";
 
-static TaskHandle_t task;
+#define UART_BROADCAST (0x100) // notification flag of a message that was sent on every chain.
+
+// A chain of modules on one uart port. The modules of all chains form the display, the modules of a chain have the
+// global indices moduleBase up to moduleBase + moduleCnt.
+typedef struct {
+    uart_port_t port;
+    int txPin;
+    int rxPin;
+    size_t moduleBase;
+    size_t moduleCnt;
+    chainCommMessage_t msg;
+    TickType_t lastWakeTime;
+    TaskHandle_t task;
+    TaskHandle_t transactionTask;
+    QueueHandle_t transactionQueue[transaction_priorityLow + 1];
+    SemaphoreHandle_t transactionsPending;
+} uart_chain_t;
+
+// A transaction that is executed on every chain, the callback is called by the chain that finishes last.
+typedef struct {
+    uart_transaction_t transaction;
+    atomic_int pending;
+    atomic_bool failed;
+} uart_fanOut_t;
 
-static chainCommMessage_t msg;
+static uart_chain_t chains[UART_CHAIN_CNT] = {
+    {.port = UART_NUM, .txPin = TX_PIN, .rxPin = RX_PIN},
+#if UART_CHAIN_CNT > 1
+    {.port = UART_NUM_CHAIN1, .txPin = TX_PIN_CHAIN1, .rxPin = RX_PIN_CHAIN1},
+#endif
+};
+static bool modulesMoved;
+
+static chainCommMessage_t broadcastMsg;
+static TaskHandle_t broadcastTask;
+static atomic_int broadcastPending;
 
 static uart_modulePropertyHandler_t uart_modulePropertyHandlers[MAX_PROPERTIES] = {0};
 
+static uart_chain_t *uart_currentChain()
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (int i = 0; i < UART_CHAIN_CNT; i++) {
+        if (chains[i].transactionTask == self) {
+            return &chains[i];
+        }
+    }
+    return NULL;
+}
+
+static chainCommMessage_t *msg_current()
+{
+    uart_chain_t *chain = uart_currentChain();
+    return chain ? &chain->msg : &broadcastMsg;
+}
+
 void msg_init()
 {
-    memset(&msg, 0, sizeof(chainCommMessage_t));
+    memset(msg_current(), 0, sizeof(chainCommMessage_t));
 }
 
 void msg_newReadAll(moduleProperty_t property)
@@ -36,22 +87,24 @@ void msg_newWriteAll(moduleProperty_t property)
 
 void msg_addHeader(moduleAction_t action, moduleProperty_t property)
 {
-    if (msg.size > 0) {
+    chainCommMessage_t *msg = msg_current();
+    if (msg->size > 0) {
         ESP_LOGE(TAG, "Message is not empty");
         return;
     }
-    msg.structured.header.field.action = action;
-    msg.structured.header.field.property = property;
-    msg.size++;
+    msg->structured.header.field.action = action;
+    msg->structured.header.field.property = property;
+    msg->size++;
 }
 
 void msg_addData(uint8_t byte)
 {
-    if (msg.size >= CHAIN_COM_MAX_LEN) {
+    chainCommMessage_t *msg = msg_current();
+    if (msg->size >= CHAIN_COM_MAX_LEN) {
         ESP_LOGE(TAG, "Message buffer is full");
         return;
     }
-    msg.raw[msg.size++] = byte;
+    msg->raw[msg->size++] = byte;
 }
 
 void msg_sendDoNothing(const unsigned commandPeriod)
@@ -61,26 +114,42 @@ void msg_sendDoNothing(const unsigned commandPeriod)
     msg_send(commandPeriod);
 }
 
+static void uart_write(uart_chain_t *chain, chainCommMessage_t *msg, uint32_t notification)
+{
+    // char *buf = calloc(1, msg->size * 3 * sizeof(char) + 1);
+    // for (int i = 0; i < msg->size; i++) {
+    //     sprintf(buf + 3 * i, "%02X ", msg->raw[i]);
+    // }
+    // ESP_LOGI(TAG, "TX --> %s", buf);
+    // free(buf);
+
+    xTaskNotify(chain->task, notification, eSetValueWithoutOverwrite);
+    uart_write_bytes(chain->port, msg->raw, msg->size);
+}
+
 void msg_send(const unsigned commandPeriod)
 {
-    static TickType_t xLastWakeTime = 0;
-    if (!msg.size || msg.size >= CHAIN_COM_MAX_LEN) {
-        ESP_LOGE(TAG, "Message size (%d) is invalid", msg.size);
+    static TickType_t broadcastLastWakeTime = 0;
+    uart_chain_t *chain = uart_currentChain();
+    chainCommMessage_t *msg = chain ? &chain->msg : &broadcastMsg;
+    TickType_t *lastWakeTime = chain ? &chain->lastWakeTime : &broadcastLastWakeTime;
+    if (!msg->size || msg->size >= CHAIN_COM_MAX_LEN) {
+        ESP_LOGE(TAG, "Message size (%d) is invalid", msg->size);
         return;
     }
     if (commandPeriod) {
-        xTaskDelayUntil(&xLastWakeTime, commandPeriod / portTICK_RATE_MS);
+        xTaskDelayUntil(lastWakeTime, commandPeriod / portTICK_RATE_MS);
     }
-    // char *buf = calloc(1, msg.size * 3 * sizeof(char) + 1);
-    // for (int i = 0; i < msg.size; i++) {
-    //     sprintf(buf + 3 * i, "%02X ", msg.raw[i]);
-    // }
-    // ESP_LOGI(TAG, "TX --> %s", buf);
-    // free(buf);
-
-    xTaskNotify(uartTask(), msg.structured.header.raw, eSetValueWithoutOverwrite);
-    uart_write_bytes(UART_NUM, msg.raw, msg.size);
-    xLastWakeTime = xTaskGetTickCount();
+    if (chain) {
+        uart_write(chain, msg, msg->structured.header.raw);
+    } else {
+        broadcastTask = xTaskGetCurrentTaskHandle();
+        atomic_store(&broadcastPending, UART_CHAIN_CNT);
+        for (int i = 0; i < UART_CHAIN_CNT; i++) {
+            uart_write(&chains[i], msg, msg->structured.header.raw | UART_BROADCAST);
+        }
+    }
+    *lastWakeTime = xTaskGetTickCount();
 }
 
 void uart_addModulePropertyHandler(moduleProperty_t property, uart_modulePropertyCallback_t deserialize,
@@ -94,7 +163,35 @@ void uart_addModulePropertyHandler(moduleProperty_t property, uart_modulePropert
     uart_modulePropertyHandlers[property].serialize = serialize;
 }
 
-bool uart_propertyReadAll(moduleProperty_t property)
+// Called by the uart task of a chain when its modules have been counted, the chains following it move along.
+static void uart_setChainSize(uart_chain_t *chain, size_t moduleCnt)
+{
+    display_lock();
+    if (chain->moduleCnt != moduleCnt) {
+        chain->moduleCnt = moduleCnt;
+        size_t moduleBase = 0;
+        for (int i = 0; i < UART_CHAIN_CNT; i++) {
+            if (chains[i].moduleBase != moduleBase && chains[i].moduleCnt) {
+                modulesMoved = true; // the properties read from this chain are no longer at the right index.
+            }
+            chains[i].moduleBase = moduleBase;
+            moduleBase += chains[i].moduleCnt;
+        }
+        display_setSize(moduleBase);
+    }
+    display_unlock();
+}
+
+bool uart_takeModulesMoved()
+{
+    display_lock();
+    bool moved = modulesMoved;
+    modulesMoved = false;
+    display_unlock();
+    return moved;
+}
+
+static bool uart_propertyReadAll(uart_chain_t *chain, moduleProperty_t property)
 {
     if ((property <= no_property && property >= end_of_properties) ||
         !uart_modulePropertyHandlers[property].deserialize) {
@@ -103,78 +200,151 @@ bool uart_propertyReadAll(moduleProperty_t property)
     }
     msg_newReadAll(property);
     msg_send(MAX_COMMAND_PERIOD_MS);
-    ulTaskNotifyTake(true, 5000 / portTICK_RATE_MS); // wait for command to finish
-    return true;
+    return ulTaskNotifyTake(true, 5000 / portTICK_RATE_MS) != 0; // wait for command to finish
 }
 
-bool uart_propertyWriteAll(moduleProperty_t property)
+static bool uart_propertyWriteAll(uart_chain_t *chain, moduleProperty_t property)
 {
     if ((property <= no_property && property >= end_of_properties) ||
-        !uart_modulePropertyHandlers[property].serialize || !display_getSize()) {
+        !uart_modulePropertyHandlers[property].serialize) {
         ESP_LOGE(TAG, "No serialization defined for property %d", property);
         return false;
     }
-    for (int i = 0; i < display_getSize(); i++) {
+    // the other chains may resize the display in the meantime.
+    display_lock();
+    if (!chain->moduleCnt) {
+        display_unlock();
+        return true; // nothing to write on an empty chain.
+    }
+    for (size_t i = chain->moduleBase; i < chain->moduleBase + chain->moduleCnt; i++) {
         module_t *module = display_getModule(i);
         module->updatableProperties &= ~(1 << property);
     }
     msg_newWriteAll(property);
-    uart_modulePropertyHandlers[property].serialize(&msg.raw[msg.size], display_getModule(0));
-    msg.size += get_property_size(property);
+    uart_modulePropertyHandlers[property].serialize(&chain->msg.raw[chain->msg.size],
+                                                    display_getModule(chain->moduleBase));
+    display_unlock();
+    chain->msg.size += get_property_size(property);
     msg_addData(ACK);
     msg_send(MAX_COMMAND_PERIOD_MS);
-    ulTaskNotifyTake(true, 5000 / portTICK_RATE_MS); // wait for command to finish
-    return true;
+    return ulTaskNotifyTake(true, 5000 / portTICK_RATE_MS) != 0; // wait for command to finish
 }
 
-bool uart_propertyWriteSequential(moduleProperty_t property)
+static bool uart_propertyWriteSequential(uart_chain_t *chain, moduleProperty_t property)
 {
     if ((property <= no_property && property >= end_of_properties) ||
         !uart_modulePropertyHandlers[property].serialize) {
         ESP_LOGE(TAG, "No serialization defined for property %d", property);
         return false;
     }
-    for (int i = 0; i < display_getSize(); i++) {
-        module_t *module = display_getModule(i);
+    // the other chains may resize the display in the meantime, the lock is not held while a message is sent.
+    bool updatable = false;
+    display_lock();
+    for (size_t i = chain->moduleBase; i < chain->moduleBase + chain->moduleCnt; i++) {
+        updatable |= (display_getModule(i)->updatableProperties & (1 << property)) != 0;
+    }
+    display_unlock();
+    if (!updatable) {
+        return true; // e.g. a region write that only touches the modules of other chains.
+    }
+    for (size_t n = 0;; n++) {
+        display_lock();
+        if (n >= chain->moduleCnt) {
+            display_unlock();
+            break;
+        }
+        module_t *module = display_getModule(chain->moduleBase + n);
         if (module->updatableProperties & (1 << property)) {
             module->updatableProperties &= ~(1 << property);
             msg_newWriteSequential(property);
-            uart_modulePropertyHandlers[property].serialize(&msg.raw[msg.size], module);
-            msg.size += get_property_size(property);
-
-            msg_send(0);
+            uart_modulePropertyHandlers[property].serialize(&chain->msg.raw[chain->msg.size], module);
+            chain->msg.size += get_property_size(property);
         } else {
             msg_newWriteSequential(no_property);
-            msg_send(0);
         }
+        display_unlock();
+        msg_send(0);
     }
     msg_sendAcknowledge();
-    ulTaskNotifyTake(true, 5000 / portTICK_RATE_MS); // wait for command to finish
+    return ulTaskNotifyTake(true, 5000 / portTICK_RATE_MS) != 0; // wait for command to finish
+}
+
+bool uart_transactionSubmit(uart_transaction_t *transaction)
+{
+    if (transaction->priority > transaction_priorityLow) {
+        ESP_LOGE(TAG, "Invalid priority for property %d", transaction->property);
+        return false;
+    }
+    // the transaction is only queued when every chain can take it.
+    for (int i = 0; i < UART_CHAIN_CNT; i++) {
+        if (!uxQueueSpacesAvailable(chains[i].transactionQueue[transaction->priority])) {
+            ESP_LOGE(TAG, "Failed to queue transaction for property %d on chain %d", transaction->property, i);
+            return false;
+        }
+    }
+    uart_fanOut_t *fanOut = malloc(sizeof(uart_fanOut_t));
+    if (!fanOut) {
+        ESP_LOGE(TAG, "Failed to allocate memory for transaction");
+        return false;
+    }
+    fanOut->transaction = *transaction;
+    atomic_init(&fanOut->pending, UART_CHAIN_CNT);
+    atomic_init(&fanOut->failed, false);
+    for (int i = 0; i < UART_CHAIN_CNT; i++) {
+        xQueueSend(chains[i].transactionQueue[transaction->priority], &fanOut, 0);
+        xSemaphoreGive(chains[i].transactionsPending);
+    }
     return true;
 }
 
-bool uart_moduleSerializedPropertiesAreEqual(moduleProperty_t property)
+static void uart_transactionFinish(uart_fanOut_t *fanOut, bool success)
 {
-    if (display_getSize() < 2 && uart_modulePropertyHandlers[property].serialize) {
-        return true;
+    if (!success) {
+        atomic_store(&fanOut->failed, true);
+    }
+    if (atomic_fetch_sub(&fanOut->pending, 1) == 1) {
+        if (fanOut->transaction.callback) {
+            fanOut->transaction.callback(fanOut->transaction.property, !atomic_load(&fanOut->failed),
+                                         fanOut->transaction.arg);
+        }
+        free(fanOut);
     }
-    char bufA[CHAIN_COM_MAX_LEN] = {0};
-    uart_modulePropertyHandlers[property].serialize(bufA, display_getModule(0));
-    char bufB[CHAIN_COM_MAX_LEN] = {0};
-    for (int i = 1; i < display_getSize(); i++) {
-        uart_modulePropertyHandlers[property].serialize(bufB, display_getModule(i));
-        for (int j = 0; j < get_property_size(property); j++) {
-            if (bufA[j] != bufB[j]) {
-                return false;
+}
+
+static void flap_uart_transaction_task(void *arg)
+{
+    uart_chain_t *chain = arg;
+    uart_fanOut_t *fanOut = NULL;
+    while (1) {
+        if (xSemaphoreTake(chain->transactionsPending, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        // Take the highest priority transaction, transactions are executed back to back.
+        for (uart_transactionPriority_t p = transaction_priorityHigh; p <= transaction_priorityLow; p++) {
+            if (xQueueReceive(chain->transactionQueue[p], &fanOut, 0) == pdTRUE) {
+                break;
             }
         }
+        ulTaskNotifyTake(true, 0); // clear stale completion notifications.
+        bool success = false;
+        switch (fanOut->transaction.type) {
+            case transaction_readAll:
+                success = uart_propertyReadAll(chain, fanOut->transaction.property);
+                break;
+            case transaction_writeAll:
+                success = uart_propertyWriteAll(chain, fanOut->transaction.property);
+                break;
+            case transaction_writeSequential:
+                success = uart_propertyWriteSequential(chain, fanOut->transaction.property);
+                break;
+        }
+        uart_transactionFinish(fanOut, success);
     }
-    return true;
 }
 
-uint32_t uart_receive(char *buf, uint32_t length, TickType_t ticks_to_wait)
+static uint32_t uart_receive(uart_chain_t *chain, char *buf, uint32_t length, TickType_t ticks_to_wait)
 {
-    uint32_t len = uart_read_bytes(UART_NUM, buf, length, ticks_to_wait);
+    uint32_t len = uart_read_bytes(chain->port, buf, length, ticks_to_wait);
     // if (len > 0) {
     //     char *print_buf = calloc(len * 3 + 1, 1);
     //     for (int i = 0; i < len; i++) {
@@ -186,8 +356,20 @@ uint32_t uart_receive(char *buf, uint32_t length, TickType_t ticks_to_wait)
     return len;
 }
 
+// Signals the sender of a message that the chain has answered.
+static void uart_messageDone(uart_chain_t *chain, bool broadcast)
+{
+    if (!broadcast) {
+        xTaskAbortDelay(chain->transactionTask); // allow the uart port to be used again without delay.
+        xTaskNotify(chain->transactionTask, fromUart, eSetValueWithoutOverwrite);
+    } else if (atomic_fetch_sub(&broadcastPending, 1) == 1) {
+        xTaskAbortDelay(broadcastTask); // every chain has answered, the next message can be sent without delay.
+    }
+}
+
 static void flap_uart_task(void *arg)
 {
+    uart_chain_t *chain = arg;
     uint32_t len = 0;
     uint16_t module_total = 0, module_index = 0;
     bool waitingForWriteSequentialAck = false;
@@ -196,27 +378,23 @@ static void flap_uart_task(void *arg)
 
     chainCommHeader_t header;
     while (1) {
-        header.raw = (uint8_t)ulTaskNotifyTake(true, 250 / portTICK_RATE_MS);
+        uint32_t notification = ulTaskNotifyTake(true, 250 / portTICK_RATE_MS);
+        header.raw = (uint8_t)notification;
         switch (header.field.action) {
             case property_writeAll:
                 expected_rx_len = get_property_size(header.field.property) + WRITE_HEADER_LEN + ACKNOWLEDGE_LEN;
-                len = uart_receive(buf, expected_rx_len, 250 / portTICK_RATE_MS);
+                len = uart_receive(chain, buf, expected_rx_len, 250 / portTICK_RATE_MS);
                 if (len != expected_rx_len) {
                     ESP_LOGE(TAG, "Received %ld bytes but expected %ld bytes for this \"writeAll\" command.", len,
                              expected_rx_len);
                     break;
                 }
-                uart_flush_input(UART_NUM);
-                if (header.field.property == firmware_property) {
-                    xTaskAbortDelay(httpTask()); // allow the uart port to be used again without delay.
-                } else {
-                    xTaskAbortDelay(modelTask()); // allow the uart port to be used again without delay.
-                    xTaskNotify(modelTask(), fromUart, eSetValueWithoutOverwrite);
-                }
+                uart_flush_input(chain->port);
+                uart_messageDone(chain, notification & UART_BROADCAST);
                 break;
             case property_readAll:
                 expected_rx_len = READ_HEADER_LEN;
-                len = uart_receive(buf, expected_rx_len, 250 / portTICK_RATE_MS);
+                len = uart_receive(chain, buf, expected_rx_len, 250 / portTICK_RATE_MS);
 
                 if (len != expected_rx_len) {
                     ESP_LOGE(TAG, "Received %ld bytes but expected a %ld byte \"readAll\" header.", len,
@@ -224,27 +402,31 @@ static void flap_uart_task(void *arg)
                     break;
                 }
                 module_total = buf[1] + buf[2] * 0xff;
-                display_setSize(module_total);
+                uart_setChainSize(chain, module_total);
 
                 expected_rx_len = get_property_size(header.field.property);
                 ESP_LOGI(TAG, "Expecting %ld bytes from %d modules", expected_rx_len, module_total);
                 for (module_index = 0; module_index < module_total; module_index++) {
-                    // len = uart_receive(buf, expected_rx_len, 250 / portTICK_RATE_MS);
+                    // len = uart_receive(chain, buf, expected_rx_len, 250 / portTICK_RATE_MS);
                     // this is to slow because of the printing.
-                    len = uart_read_bytes(UART_NUM, buf, expected_rx_len, 250 / portTICK_RATE_MS);
+                    len = uart_read_bytes(chain->port, buf, expected_rx_len, 250 / portTICK_RATE_MS);
                     if (len != expected_rx_len) {
                         ESP_LOGE(TAG, "1 Received %ld bytes but expected %ld bytes from this property", len,
                                  expected_rx_len);
                         break;
                     }
-                    module_t *module = display_getModule(module_index);
+                    // the other chains may resize the display in the meantime.
+                    display_lock();
+                    module_t *module = display_getModule(chain->moduleBase + module_index);
                     if (uart_modulePropertyHandlers[header.field.property].deserialize && module) {
                         uart_modulePropertyHandlers[header.field.property].deserialize(buf, module);
                     }
-                    module->updatableProperties = 0; // don't update the modules again.
+                    if (module) {
+                        module->updatableProperties = 0; // don't update the modules again.
+                    }
+                    display_unlock();
                 }
-                xTaskAbortDelay(modelTask()); // allow the uart port to be used again without delay.
-                xTaskNotify(modelTask(), fromUart, eSetValueWithoutOverwrite);
+                uart_messageDone(chain, notification & UART_BROADCAST);
                 break;
             case property_writeSequential:
                 waitingForWriteSequentialAck = true;
@@ -252,17 +434,16 @@ static void flap_uart_task(void *arg)
             default:
                 if (waitingForWriteSequentialAck) {
                     waitingForWriteSequentialAck = 0;
-                    len = uart_receive(buf, 1, 250 / portTICK_RATE_MS);
+                    len = uart_receive(chain, buf, 1, 250 / portTICK_RATE_MS);
                     if (len != 1) {
                         ESP_LOGE(TAG, "Received %ld bytes but expected %d bytes for this \"writeSequential\" command.",
                                  len, 1);
                         break;
                     }
-                    xTaskAbortDelay(modelTask()); // allow the uart port to be used again without delay.
-                    xTaskNotify(modelTask(), fromUart, eSetValueWithoutOverwrite);
+                    uart_messageDone(chain, notification & UART_BROADCAST);
                     break;
                 }
-                len = uart_receive(buf, CMD_BUFF_SIZE, 0);
+                len = uart_receive(chain, buf, CMD_BUFF_SIZE, 0);
                 if (len) {
                     ESP_LOGW(TAG, "Received %ld unexpected bytes", len);
                 }
@@ -281,15 +462,22 @@ void flap_uart_init(void)
         .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
         .source_clk = UART_SCLK_APB,
     };
-    ESP_ERROR_CHECK(uart_driver_install(UART_NUM, UART_BUF_SIZE, UART_BUF_SIZE, 0, NULL, 0));
-    ESP_ERROR_CHECK(uart_param_config(UART_NUM, &uart_config));
-    ESP_ERROR_CHECK(uart_set_pin(UART_NUM, TX_PIN, RX_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE));
+    for (int i = 0; i < UART_CHAIN_CNT; i++) {
+        uart_chain_t *chain = &chains[i];
+        ESP_ERROR_CHECK(uart_driver_install(chain->port, UART_BUF_SIZE, UART_BUF_SIZE, 0, NULL, 0));
+        ESP_ERROR_CHECK(uart_param_config(chain->port, &uart_config));
+        ESP_ERROR_CHECK(uart_set_pin(chain->port, chain->txPin, chain->rxPin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE));
 
-    xTaskCreate(flap_uart_task, "flap_uart_task", 6000, NULL, 10, &task);
-    uart_api_init();
-}
+        for (uart_transactionPriority_t p = transaction_priorityHigh; p <= transaction_priorityLow; p++) {
+            chain->transactionQueue[p] = xQueueCreate(TRANSACTION_QUEUE_LEN, sizeof(uart_fanOut_t *));
+            configASSERT(chain->transactionQueue[p]);
+        }
+        chain->transactionsPending = xSemaphoreCreateCounting(2 * TRANSACTION_QUEUE_LEN, 0);
+        configASSERT(chain->transactionsPending);
 
-TaskHandle_t uartTask()
-{
-    return task;
+        xTaskCreate(flap_uart_task, "flap_uart_task", 6000, chain, 10, &chain->task);
+        xTaskCreate(flap_uart_transaction_task, "flap_uart_transaction_task", 6000, chain, 10,
+                    &chain->transactionTask);
+    }
+    uart_api_init();
 }
@@ -1,6 +1,10 @@
 
 const moduleEndpoint = "/api/modules"
 // const moduleEndpoint = "http://openflap.local/api/modules" // enable this line for local development
+const displayEndpoint = "/api/display"
+// const displayEndpoint = "http://openflap.local/api/display" // enable this line for local development
+const calibrationEndpoint = "/api/calibration"
+// const calibrationEndpoint = "http://openflap.local/api/calibration" // enable this line for local development
 
 var moduleObjects = [];
 var dimensions = { width: 0, height: 0 };
@@ -62,16 +66,19 @@ function createModuleTable() {
     }
 }
 
-function calculateDisplayDimensions() {
-    var width = 0;
-    moduleObjects.forEach(module => width += (module.columnEnd));
-    var height = moduleObjects.length / width;
-    if (!Number.isInteger(height)) {
+async function displayGetGeometry() {
+    const response = await fetch(displayEndpoint, { method: "GET" });
+    return await response.json();
+}
+
+async function calculateDisplayDimensions() {
+    const geometry = await displayGetGeometry();
+    if (geometry.columns.some(column => column.length != geometry.height)) {
         console.log("The display is not rectangular!");
         return
     }
-    dimensions.height = height;
-    dimensions.width = width
+    dimensions.height = geometry.height;
+    dimensions.width = geometry.width
     let root = document.querySelector(':root');
     root.style.setProperty('--dispWidth', dimensions.width);
     root.style.setProperty('--dispHeight', dimensions.height);
@@ -94,7 +101,7 @@ function createDisplay() {
 async function initialize() {
     moduleObjects = await moduleGetAll();
     createModuleTable();
-    calculateDisplayDimensions();
+    await calculateDisplayDimensions();
     createDisplay();
 }
 
@@ -277,23 +284,25 @@ async function modulesSetProperties(properties) {
     });
 }
 
-function startCalibration() {
-    for (let i = 0; i < moduleObjects.length; i++) {
-        trySetLetter(i, moduleObjects[i].characterMap[0]);
-        moduleObjects[i].offset = 0;
-        moduleObjects[i].vtrim = 0;
-    }
-    modulesSetProperties(["character", "offset", "vtrim"]);
+async function startCalibration() {
+    // the controller turns every module once, sets the encoder thresholds and shows the first character of every map.
+    const response = await fetch(calibrationEndpoint, { method: "POST" });
+    const results = await response.json();
+    results.filter(result => !result.valid).forEach(result => console.log("module " + result.module + " could not be calibrated"));
+    moduleObjects = await moduleGetAll();
     createModuleTable();
+    createDisplay();
 }
 
-function doCalibration() {
-    for (let i = 0; i < moduleObjects.length; i++) {
-        moduleObjects[i].offset += moduleObjects[i].characterMap.indexOf(moduleObjects[i].character);
-        if (moduleObjects[i].offset >= moduleObjects[i].characterMap.length) moduleObjects[i].offset -= moduleObjects[i].characterMap.length; 0
-        trySetLetter(i, moduleObjects[i].characterMap[0]);
-    }
-    modulesSetProperties(["character", "offset"]);
+async function doCalibration() {
+    // enter the characters the modules show, the controller corrects all offsets at once.
+    await fetch(calibrationEndpoint + "/offset", {
+        method: "POST",
+        body: moduleObjects.map(module => module.character).join("")
+    });
+    moduleObjects = await moduleGetAll();
+    createModuleTable();
+    createDisplay();
 }
 
 async function setAccessPoint(type) {
@@ -0,0 +1,59 @@
+#ifndef FLAP_CALIBRATION_H
+#define FLAP_CALIBRATION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+#include "esp_log.h"
+
+#include "Model.h"
+#include "flap_playlist.h"
+
+/*
+ * The calibration runs on all modules at once. A run turns every module one revolution while it records the range of
+ * each IR sensor, the threshold of a sensor is the middle of its range. The new irLimits are written in a single pass,
+ * the next pass turns every module to the first character of its map. The encoder has no absolute reference, so the
+ * offsets follow from the characters the modules show after the run, these are passed to calibration_setOffsets.
+ * From the start of a run until the offsets are set the playlist is paused and calibration_isActive is true, so no
+ * other writer changes the characters that are read from the wall.
+ */
+#define CALIBRATION_MIN_CONTRAST 100   // lowest range of a sensor that gives a usable threshold, in 10 bit ADC counts.
+#define CALIBRATION_MARGIN_MS    2000  // added to the predicted time of a revolution before the modules are polled.
+#define CALIBRATION_POLL_MS      500
+#define CALIBRATION_TIMEOUT_MS   20000 // the modules abort a revolution that does not end after 15 s.
+#define CALIBRATION_OFFSET_TIMEOUT_MS 300000 // a calibration whose offsets are not set is abandoned after 5 min.
+
+typedef struct {
+    bool valid;            // the module did not stall and every sensor had enough contrast, else its irLimits are kept.
+    uint8_t positionsSeen; // encoder codes decoded during the revolution, with the limits from before the run.
+    uint16_t irMin[MODULE_IR_SENSOR_CNT];
+    uint16_t irMax[MODULE_IR_SENSOR_CNT];
+    uint16_t irLimits[MODULE_IR_SENSOR_CNT];
+} calibration_result_t;
+
+typedef enum {
+    calibration_idle,
+    calibration_running,          // the modules turn their revolution.
+    calibration_awaitingOffsets,  // the modules show the first character of their map.
+} calibration_state_t;
+
+typedef enum {
+    calibration_done,
+    calibration_busy,        // another run is in progress.
+    calibration_chainFailed,
+} calibration_status_t;
+
+void flap_calibration_init(void);
+// Runs the calibration revolution, results receives the result of each module in chain order, which must be freed.
+calibration_status_t calibration_run(calibration_result_t **results, size_t *cnt);
+// shown holds the UTF-8 character each module shows in chain order while it is set to the first character of its map.
+// valid is cleared if a character is not in the map of its module, that module keeps its offset. Returns false if the
+// chain failed.
+bool calibration_setOffsets(const char *shown, bool *valid);
+bool calibration_isActive(void); // true from the start of a run until its offsets are set.
+
+#endif
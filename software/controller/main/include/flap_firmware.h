@@ -14,6 +14,7 @@
 #include "Model.h"
 
 void flap_verify_controller_firmware();
+// total_data_len is 0 until the last block of the image, the last block passes the size of the image.
 void flap_controller_firmware_update(char *data,size_t data_len,size_t data_offset,size_t total_data_len);
 void flap_module_firmware_update(char *data,size_t data_len,size_t data_offset,size_t total_data_len);
 #endif
\ No newline at end of file
@@ -10,29 +10,77 @@
 #include "esp_http_server.h"
 #include "cJSON.h"
 
-#include <regex.h>
-
 #include "HttpApi.h"
+#include "JsonStream.h"
+#include "Multipart.h"
 #include "flap_firmware.h"
 #include "chain_comm_abi.h"
 #include "flap_nvs.h"
+#include "flap_playlist.h"
+#include "flap_calibration.h"
 
+// The web assets are embedded gzip compressed and uncompressed, their hashes are generated by the build.
+extern const uint8_t index_gz_start[]       asm("_binary_index_html_gz_start");
+extern const uint8_t index_gz_end[]         asm("_binary_index_html_gz_end");
 extern const uint8_t index_start[]          asm("_binary_index_html_start");
 extern const uint8_t index_end[]            asm("_binary_index_html_end");
+extern const uint8_t style_gz_start[]       asm("_binary_style_css_gz_start");
+extern const uint8_t style_gz_end[]         asm("_binary_style_css_gz_end");
 extern const uint8_t style_start[]          asm("_binary_style_css_start");
 extern const uint8_t style_end[]            asm("_binary_style_css_end");
+extern const uint8_t favicon_gz_start[]     asm("_binary_favicon_svg_gz_start");
+extern const uint8_t favicon_gz_end[]       asm("_binary_favicon_svg_gz_end");
 extern const uint8_t favicon_start[]        asm("_binary_favicon_svg_start");
 extern const uint8_t favicon_end[]          asm("_binary_favicon_svg_end");
-extern const uint8_t script_start[]        asm("_binary_script_js_start");
-extern const uint8_t script_end[]          asm("_binary_script_js_end");
+extern const uint8_t script_gz_start[]      asm("_binary_script_js_gz_start");
+extern const uint8_t script_gz_end[]        asm("_binary_script_js_gz_end");
+extern const uint8_t script_start[]         asm("_binary_script_js_start");
+extern const uint8_t script_end[]           asm("_binary_script_js_end");
+
+#define HTTP_ASSET_MAX_AGE "31536000" // assets other than index.html are versioned by their url.
+
+#define HTTP_QUERY_LEN 128
+#define HTTP_FIRMWARE_RECV_LEN 4096
+
+#define HTTP_CHUNK_LEN 1024
+
+#define HTTP_ASYNC_WORKER_CNT 2 // tasks serving the requests that wait for the chain.
+#define HTTP_ASYNC_QUEUE_LEN  4
+
+#define MAX_WS_CONNECTIONS 4
+#define WS_MAX_MESSAGE_LEN 4096
+
+struct http_jsonWriter;
+// Sends the buffered output of a writer. final is set for the last part of the output.
+typedef esp_err_t (*http_jsonSendCallback_t)(struct http_jsonWriter *writer, bool final);
+
+// Buffers json output and passes it to the send callback whenever the buffer is full.
+typedef struct http_jsonWriter {
+    http_jsonSendCallback_t send;
+    void *arg;     // http request or websocket of the output.
+    esp_err_t err; // first error returned by the send callback, further output is dropped.
+    size_t sentCnt;
+    size_t len;
+    char buf[HTTP_CHUNK_LEN];
+} http_jsonWriter_t;
 
 typedef bool (*http_modulePropertyCallback_t)(cJSON**, module_t*);
+typedef bool (*http_modulePropertyWriter_t)(http_jsonWriter_t*, module_t*);
 
 typedef struct{
-    http_modulePropertyCallback_t toJson;
+    http_modulePropertyWriter_t toJson;
     http_modulePropertyCallback_t fromJson;
 }http_modulePropertyHandler_t;
-void http_addModulePropertyHandler(moduleProperty_t property, http_modulePropertyCallback_t toJson, http_modulePropertyCallback_t fromJson);
+void http_addModulePropertyHandler(moduleProperty_t property, http_modulePropertyWriter_t toJson, http_modulePropertyCallback_t fromJson);
+
+void http_jsonWriteRaw(http_jsonWriter_t *writer, const char *data, size_t len);
+void http_jsonWriteString(http_jsonWriter_t *writer, const char *string, size_t maxLen);
+void http_jsonWriteNumber(http_jsonWriter_t *writer, int number);
+void http_jsonWriteBool(http_jsonWriter_t *writer, bool value);
+void http_jsonFlush(http_jsonWriter_t *writer);
+void http_jsonFinish(http_jsonWriter_t *writer);
+
+void http_publishModuleChanges(); // sends the changed properties of the front frame to all websocket clients.
 
 httpd_handle_t flap_start_webserver(void);
 esp_err_t trigger_async_send(char *json_data);
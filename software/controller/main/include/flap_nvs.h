@@ -12,5 +12,7 @@ esp_err_t nvs_init();
 esp_err_t flap_nvs_erase_key(char *field_key);
 esp_err_t flap_nvs_get_string(char *field_key, char **field_value);
 esp_err_t flap_nvs_set_string(char *field_key, char *field_value);
+esp_err_t flap_nvs_get_blob(char *field_key, void **field_value, size_t *field_len); // field_value must be freed.
+esp_err_t flap_nvs_set_blob(char *field_key, void *field_value, size_t field_len);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef FLAP_PLAYLIST_H
+#define FLAP_PLAYLIST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+#include "Model.h"
+
+/*
+ * The playlist is a list of frames and texts that the controller shows in a loop, each for its hold time:
+ * {"enabled":true,"items":[{"text":"NEXT TRAIN\n12:04","hold":5000,"align":"center"},{"frame":"ABCD","hold":2000}]}
+ * A text item takes the options of POST /api/text ("align", "wrap", "row" and "clear"), a frame item holds a UTF-8
+ * character per module in chain order. Both take "transition" and "duration" to stagger the start of the modules. The
+ * playlist is kept in NVS as this json.
+ */
+#define PLAYLIST_NVS_KEY     "playlist"
+#define PLAYLIST_MAX_LEN     4096 // longest playlist json accepted, the nvs partition only has 16 kB.
+#define PLAYLIST_MIN_HOLD_MS 100
+#define PLAYLIST_MAX_LAG_MS  1000 // when a frame is shown later than this, the schedule restarts from now.
+#define PLAYLIST_NO_DISPLAY_RETRY_MS 1000 // period at which an empty display is looked at again.
+
+typedef enum {
+    playlist_itemText,
+    playlist_itemFrame,
+} playlist_itemType_t;
+
+typedef struct {
+    playlist_itemType_t type;
+    uint32_t holdMs;
+    display_textLayout_t layout; // layout of a text item.
+    Transition_t transition;
+    char *content;               // UTF-8 text, or the character of each module of a frame.
+} playlist_item_t;
+
+typedef struct {
+    bool enabled;
+    size_t itemCnt;
+    playlist_item_t *item;
+    char *json; // the playlist as stored in NVS, null terminated.
+} playlist_t;
+
+void flap_playlist_init(void); // loads the playlist from NVS and starts the sequencer task.
+bool playlist_set(const char *json, size_t len); // returns false if the json is not a valid playlist.
+char *playlist_getJson(void); // returns the json of the current playlist, which must be freed, or NULL.
+// Stops showing items, once it returns the playlist no longer writes to the display until playlist_resume.
+void playlist_pause(void);
+void playlist_resume(void); // continues at the first item of the playlist.
+
+#endif
@@ -2,6 +2,7 @@
 #define FLAP_SOCKET_SERVER_H
 
 
+#include <stdatomic.h>
 #include <string.h>
 #include <sys/param.h>
 #include "freertos/FreeRTOS.h"
@@ -25,6 +26,11 @@
 #define KEEPALIVE_INTERVAL          5
 #define KEEPALIVE_COUNT             3
 
+#define LOG_RING_LEN                8192 // must be a power of 2.
+#define LOG_LINE_LEN                256
+#define LOG_BATCH_LEN               1460 // one tcp segment.
+#define LOG_DRAIN_PERIOD_MS         50
+
 void flap_init_socket_server(void);
 
 #endif
\ No newline at end of file
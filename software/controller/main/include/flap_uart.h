@@ -4,6 +4,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "driver/uart.h"
 #include "esp_log.h"
 #include <stdio.h>
@@ -15,13 +16,24 @@
 #include "Model.h"
 
 #define UART_BUF_SIZE (1024)
-#define UART_NUM UART_NUM_1
+// Number of independent chains. Each chain has its own uart port and tasks, so the chains are updated in parallel.
+#ifndef UART_CHAIN_CNT
+#define UART_CHAIN_CNT 1
+#endif
+#if UART_CHAIN_CNT < 1 || UART_CHAIN_CNT > 2
+#error "UART_CHAIN_CNT must be 1 or 2, uart 0 is used by the console."
+#endif
+#define UART_NUM UART_NUM_1 // first chain
 #define TX_PIN  (10)
 #define RX_PIN  (9)
+#define UART_NUM_CHAIN1 UART_NUM_2 // second chain
+#define TX_PIN_CHAIN1 (17)
+#define RX_PIN_CHAIN1 (16)
 #define MAX_UART_API_ENDPOINTS 32
 #define CMD_BUFF_SIZE 255
 #define CMD_COMM_BUF_LEN 2048
 #define EXTEND (0x80)
+#define TRANSACTION_QUEUE_LEN 16
 
 typedef union{
     struct{
@@ -39,6 +51,27 @@ typedef struct{
     uart_modulePropertyCallback_t serialize;
 }uart_modulePropertyHandler_t;
 
+typedef enum{
+    transaction_readAll,
+    transaction_writeAll,
+    transaction_writeSequential,
+}uart_transactionType_t;
+
+typedef enum{
+    transaction_priorityHigh, // e.g. the writes of a pass, these pre-empt queued low priority transactions.
+    transaction_priorityLow,  // e.g. bulk characterMap reads.
+}uart_transactionPriority_t;
+
+typedef void (*uart_transactionCallback_t)(moduleProperty_t property, bool success, void *arg);
+
+typedef struct{
+    uart_transactionType_t type;
+    moduleProperty_t property;
+    uart_transactionPriority_t priority;
+    uart_transactionCallback_t callback; // called once the transaction has finished on every chain.
+    void *arg;
+}uart_transaction_t;
+
 void msg_init();
 void msg_newReadAll(moduleProperty_t property);
 void msg_newWriteAll(moduleProperty_t property);
@@ -49,13 +82,9 @@ void msg_send(const unsigned commandPeriod);
 void msg_sendDoNothing(const unsigned commandPeriod);
 inline void msg_sendAcknowledge(){msg_sendDoNothing(MAX_COMMAND_PERIOD_MS);}
    
-bool uart_propertyReadAll(moduleProperty_t property);
-bool uart_propertyWriteAll(moduleProperty_t property);
-bool uart_propertyWriteSequential(moduleProperty_t property);
-bool uart_moduleSerializedPropertiesAreEqual(moduleProperty_t property);
+bool uart_transactionSubmit(uart_transaction_t *transaction); // the transaction is executed on every chain.
+bool uart_takeModulesMoved(); // true when modules moved to another global index since the last call.
 
 void uart_addModulePropertyHandler(moduleProperty_t property, uart_modulePropertyCallback_t deserialize, uart_modulePropertyCallback_t serialize);
 void flap_uart_init();
-
-TaskHandle_t uartTask();
 #endif
\ No newline at end of file
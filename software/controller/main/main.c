@@ -1,10 +1,12 @@
 #define DO_GENERATE_PROPERTY_NAMES
 #include "Model.h"
 #include "board_io.h"
+#include "flap_calibration.h"
 #include "flap_firmware.h"
 #include "flap_http_server.h"
 #include "flap_mdns.h"
 #include "flap_nvs.h"
+#include "flap_playlist.h"
 #include "flap_socket_server.h"
 #include "flap_uart.h"
 #include "flap_wifi.h"
@@ -82,6 +84,8 @@ void app_main(void)
     // init uart
     flap_uart_init();
     flap_model_init();
+    flap_playlist_init();
+    flap_calibration_init();
     ESP_LOGI(TAG, "OpenFlap Controller started!");
 
     gpio_set_level(FLAP_ENABLE_PIN, 1);
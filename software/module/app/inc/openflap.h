@@ -5,9 +5,20 @@
 #include "flash.h"
 #include "platform.h"
 
+/** Recovery state of a motor that stopped making progress. */
+typedef enum {
+    motor_running, /**< Driven by the distance to the setpoint. */
+    motor_kick,    /**< Driven with a short strong pulse to break the wheel loose. */
+    motor_backoff, /**< Off for a while before the next attempt. */
+} motor_recovery_t;
+
 /** Struct with helper variables. */
 typedef struct openflap_ctx_tag {
     uint8_t flap_setpoint;              /**< The desired position of flap wheel. */
+    uint8_t flap_setpoint_pending;      /**< The setpoint that is applied once the character delay has passed. */
+    bool setpoint_pending;              /**< Flag to indicate a setpoint is waiting for its character delay. */
+    uint32_t setpoint_tick;             /**< The time when the pending setpoint is applied. */
+    uint16_t character_delay;           /**< Delay in ms before the next character written is applied. */
     uint8_t flap_position;              /**< The current position of flap wheel. */
     openflap_config_t config;           /**< The configuration data. */
     chain_comm_ctx_t chain_ctx;         /**< The chain communication context. */
@@ -18,6 +29,28 @@ typedef struct openflap_ctx_tag {
     bool comms_active;                  /**< Flag to indicate if the communication is busy. */
     uint32_t comms_active_timeout_tick; /**< The time when the communication busy timeout will occur. */
     uint16_t ir_tick_cnt;               /**< Counter for determining IR sensor state. */
+    bool moving;                        /**< Flag to indicate the wheel is turning towards its setpoint. */
+    uint32_t move_start_tick;           /**< The time when the current move started. */
+    uint8_t move_position;              /**< The position of the flap wheel when the current move last advanced. */
+    uint16_t move_flaps;                /**< Number of flaps the wheel has turned during the current move. */
+    bool move_stalled;                  /**< Flag to indicate the motor stalled during the current move. */
+    uint16_t flap_period;               /**< Average time in ms per flap over the recent moves, 0 if unknown. */
+    bool calibrating;                   /**< Flag to indicate the encoder statistics are being recorded. */
+    uint32_t calibration_timeout_tick;  /**< The time when an unfinished calibration is aborted. */
+    uint16_t ir_min[SENS_CNT];          /**< Lowest ADC reading of each IR sensor during the calibration. */
+    uint16_t ir_max[SENS_CNT];          /**< Highest ADC reading of each IR sensor during the calibration. */
+    uint64_t positions_seen;            /**< Bit mask of the raw encoder codes decoded during the calibration. */
+    uint8_t encoder_graycode;           /**< The last state of each IR sensor, kept while a reading is ambiguous. */
+    uint16_t ir_track_min[SENS_CNT];    /**< Lowest ADC reading of each IR sensor while turning, decays per cycle. */
+    uint16_t ir_track_max[SENS_CNT];    /**< Highest ADC reading of each IR sensor while turning, decays per cycle. */
+    uint8_t ir_track_seen[SENS_CNT];    /**< The states each IR sensor has shown since its range last decayed. */
+    uint16_t ir_limits_flash[SENS_CNT]; /**< The sensor thresholds as last stored in flash. */
+    uint8_t progress_position;          /**< The position of the flap wheel when it last made progress. */
+    uint32_t progress_tick;             /**< The time when the flap wheel last made progress. */
+    motor_recovery_t recovery;          /**< The recovery state of the motor. */
+    uint32_t recovery_tick;             /**< The time when the current kick or back-off ends. */
+    uint8_t stall_retries;              /**< Number of recoveries since the wheel last made progress. */
+    uint8_t fault;                      /**< The moduleFault_t flags of the module. */
 } openflap_ctx_t;
 
 /**
@@ -28,6 +61,16 @@ typedef struct openflap_ctx_tag {
  */
 uint8_t pwmDutyCycleCalc(uint8_t distance);
 
+/**
+ * \brief Calculate the PWM duty cycle of the motor and recover it when the wheel stops making progress. A stalled motor
+ * gets a kick pulse and a back-off that doubles with every retry, after the last retry the module gives up on its
+ * setpoint and raises #fault_stall.
+ *
+ * \param[inout] ctx A pointer to the openflap context.
+ * \return The PWM duty cycle.
+ */
+uint8_t motorDutyCycleCalc(openflap_ctx_t *ctx);
+
 /**
  * \brief Map the index to a range between 0 and #SYMBOL_CNT.
  *
@@ -47,6 +90,20 @@ inline uint8_t flapIndexWrapCalc(int8_t index)
  */
 void encoderPositionUpdate(openflap_ctx_t *ctx, uint32_t *adc_data);
 
+/**
+ * \brief Forget the tracked range of the IR sensors, the thresholds are kept until a new range has been seen.
+ *
+ * \param[inout] ctx A pointer to the openflap context.
+ */
+void irTrackingReset(openflap_ctx_t *ctx);
+
+/**
+ * \brief Center the threshold of every IR sensor in its tracked range and store them once they have drifted.
+ *
+ * \param[inout] ctx A pointer to the openflap context.
+ */
+void updateIrLimits(openflap_ctx_t *ctx);
+
 /**
  * \brief Generate a random seed based on the ADC data.
  *
@@ -56,6 +113,34 @@ void encoderPositionUpdate(openflap_ctx_t *ctx, uint32_t *adc_data);
  */
 uint8_t getAdcBasedRandSeed(uint32_t *adc_data);
 
+/**
+ * \brief Apply the pending setpoint once its character delay has passed.
+ *
+ * \param[inout] ctx A pointer to the openflap context.
+ */
+void updateSetpoint(openflap_ctx_t *ctx);
+
+/**
+ * \brief Measure the time per flap of every move and average it into the flap period.
+ *
+ * \param[inout] ctx A pointer to the openflap context.
+ */
+void updateFlapPeriod(openflap_ctx_t *ctx);
+
+/**
+ * \brief Start a calibration: turn the flap wheel one revolution while recording the encoder statistics.
+ *
+ * \param[inout] ctx A pointer to the openflap context.
+ */
+void calibrationStart(openflap_ctx_t *ctx);
+
+/**
+ * \brief End the calibration once the revolution is completed or has timed out.
+ *
+ * \param[inout] ctx A pointer to the openflap context.
+ */
+void updateCalibration(openflap_ctx_t *ctx);
+
 /**
  * \brief Update the internal state variable that is monitoring the motor state.
  *
@@ -58,6 +58,7 @@ int main(void)
     BSP_HSI_24MHzClockConfig();
 
     configLoad(&openflap_ctx.config);
+    irTrackingReset(&openflap_ctx);
     openflap_ctx.flap_position = SYMBOL_CNT;
     // apply the random offset to the IR Encoder tick count to prevent all sensors from drawing current at the same
     // time.
@@ -120,9 +121,11 @@ int main(void)
                               &openflap_ctx.config.symbol_set[openflap_ctx.flap_position]);
         }
 
-        // Set PWM duty cycle.
-        uint8_t distance = flapIndexWrapCalc(SYMBOL_CNT + openflap_ctx.flap_setpoint - openflap_ctx.flap_position);
-        __HAL_TIM_SET_COMPARE(&Tim3Handle, TIM_CHANNEL_1, pwmDutyCycleCalc(distance));
+        // Apply a delayed setpoint.
+        updateSetpoint(&openflap_ctx);
+
+        // Set PWM duty cycle, a stalled motor is recovered.
+        __HAL_TIM_SET_COMPARE(&Tim3Handle, TIM_CHANNEL_1, motorDutyCycleCalc(&openflap_ctx));
 
         // Communication status.
         updateCommsState(&openflap_ctx);
@@ -130,6 +133,15 @@ int main(void)
         // Motor status.
         updateMotorState(&openflap_ctx);
 
+        // Flap period.
+        updateFlapPeriod(&openflap_ctx);
+
+        // Calibration.
+        updateCalibration(&openflap_ctx);
+
+        // Encoder thresholds.
+        updateIrLimits(&openflap_ctx);
+
         // Idle logic
         if (!openflap_ctx.motor_active && !openflap_ctx.comms_active) {
             if (openflap_ctx.store_config) {
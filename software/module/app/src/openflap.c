@@ -2,6 +2,59 @@
 
 #define MOTOR_IDLE_TIMEOUT 500
 #define COMMS_IDLE_TIMEOUT 75
+#define FLAP_PERIOD_MIN_FLAPS 3 // Shorter moves are dominated by the encoder sample period.
+#define CALIBRATION_TIMEOUT 15000
+#define IR_TRACK_MIN_CONTRAST 100 // Smaller ranges of a sensor are noise, its threshold is left alone.
+#define IR_TRACK_DECAY_SHIFT 5    // The tracked range shrinks by 1/32 every cycle of a sensor, so it follows a drift.
+#define IR_TRACK_STUCK_TIME 250   // A wheel without a new position for this long is not tracked.
+#define IR_HYSTERESIS_SHIFT 3     // A reading within 1/8 of the range around the threshold keeps the sensor state.
+#define IR_LIMIT_STORE_DRIFT 16   // Thresholds are stored once they moved this far, to spare the flash.
+#define STALL_TIMEOUT 500         // Time without progress at the highest duty cycle, lower duty cycles get longer.
+#define STALL_KICK_TIME 150
+#define STALL_KICK_PWM 160
+#define STALL_BACKOFF_TIME 500    // Doubles with every retry.
+#define STALL_MAX_RETRIES 3
+
+/**
+ * \brief Get the tracked range of an IR sensor.
+ *
+ * \param[in] ctx A pointer to the openflap context.
+ * \param[in] i The index of the sensor.
+ * \return The range, 0 while it is too small to tell the two states of the sensor apart.
+ */
+static uint16_t irTrackRange(openflap_ctx_t *ctx, uint8_t i)
+{
+    if (ctx->ir_track_max[i] < ctx->ir_track_min[i] + IR_TRACK_MIN_CONTRAST) {
+        return 0;
+    }
+    return ctx->ir_track_max[i] - ctx->ir_track_min[i];
+}
+
+/**
+ * \brief Add a reading of an IR sensor to its tracked range.
+ *
+ * \param[inout] ctx A pointer to the openflap context.
+ * \param[in] i The index of the sensor.
+ * \param[in] value The ADC reading.
+ */
+static void irTrackUpdate(openflap_ctx_t *ctx, uint8_t i, uint16_t value)
+{
+    if (value < ctx->ir_track_min[i]) {
+        ctx->ir_track_min[i] = value;
+    }
+    if (value > ctx->ir_track_max[i]) {
+        ctx->ir_track_max[i] = value;
+    }
+    ctx->ir_track_seen[i] |= ctx->encoder_graycode & (1 << i) ? 0x01 : 0x02;
+    // Both ends only decay once the sensor has shown both states since the last decay, so each end has just been
+    // refreshed by a reading and neither collapses towards the level of a sensor that stays in one state.
+    if (ctx->ir_track_seen[i] == 0x03) {
+        ctx->ir_track_seen[i] = 0;
+        uint16_t decay = (ctx->ir_track_max[i] - ctx->ir_track_min[i]) >> IR_TRACK_DECAY_SHIFT;
+        ctx->ir_track_min[i] += decay;
+        ctx->ir_track_max[i] -= decay;
+    }
+}
 
 uint8_t pwmDutyCycleCalc(uint8_t distance)
 {
@@ -13,18 +66,79 @@ uint8_t pwmDutyCycleCalc(uint8_t distance)
     return (distance - 1) * (max_pwm - min_pwm) / (SYMBOL_CNT - 2) + min_pwm;
 }
 
+uint8_t motorDutyCycleCalc(openflap_ctx_t *ctx)
+{
+    uint8_t distance = flapIndexWrapCalc(SYMBOL_CNT + ctx->flap_setpoint - ctx->flap_position);
+    uint8_t pwm = pwmDutyCycleCalc(distance);
+    uint32_t now = HAL_GetTick();
+    if (!distance || ctx->flap_position != ctx->progress_position) {
+        if (ctx->recovery != motor_running) {
+            debug_io_log_info("Motor recovered\n");
+        }
+        ctx->progress_position = ctx->flap_position;
+        ctx->progress_tick = now;
+        ctx->recovery = motor_running;
+        ctx->stall_retries = 0;
+        return pwm;
+    }
+
+    switch (ctx->recovery) {
+        case motor_running:
+            if (now - ctx->progress_tick < STALL_TIMEOUT * pwmDutyCycleCalc(SYMBOL_CNT - 1) / pwm) {
+                return pwm;
+            }
+            if (ctx->stall_retries >= STALL_MAX_RETRIES) {
+                // Give up on the setpoint, so the motor and the IR sensors go idle.
+                ctx->fault |= fault_stall;
+                ctx->setpoint_pending = false;
+                ctx->flap_setpoint = ctx->flap_position;
+                debug_io_log_error("Motor stalled\n");
+                return 0;
+            }
+            ctx->stall_retries++;
+            ctx->recovery = motor_kick;
+            ctx->recovery_tick = now + STALL_KICK_TIME;
+            debug_io_log_info("Motor stall, retry %d\n", ctx->stall_retries);
+            return STALL_KICK_PWM;
+        case motor_kick:
+            if ((int32_t)(now - ctx->recovery_tick) < 0) {
+                return STALL_KICK_PWM;
+            }
+            ctx->recovery = motor_backoff;
+            ctx->recovery_tick = now + (STALL_BACKOFF_TIME << (ctx->stall_retries - 1));
+            return 0;
+        case motor_backoff:
+            if ((int32_t)(now - ctx->recovery_tick) < 0) {
+                return 0;
+            }
+            ctx->recovery = motor_running;
+            ctx->progress_tick = now;
+            return pwm;
+        default:
+            return 0;
+    }
+}
+
 void encoderPositionUpdate(openflap_ctx_t *ctx, uint32_t *adc_data)
 {
     static uint8_t old_position = SYMBOL_CNT;
-    uint8_t encoder_graycode = 0;
+    bool tracking = ctx->motor_active && ctx->recovery == motor_running &&
+                    HAL_GetTick() - ctx->progress_tick < IR_TRACK_STUCK_TIME;
 
     for (uint8_t i = 0; i < ENCODER_RESOLUTION; i++) {
-        if (adc_data[IR_MAP[i]] > ctx->config.ir_limits[i]) {
-            encoder_graycode &= ~(1 << i);
-        } else if (adc_data[IR_MAP[i]] < ctx->config.ir_limits[i]) {
-            encoder_graycode |= (1 << i);
+        uint16_t value = adc_data[IR_MAP[i]];
+        uint16_t hysteresis = irTrackRange(ctx, i) >> IR_HYSTERESIS_SHIFT;
+        if (value > ctx->config.ir_limits[i] + hysteresis) {
+            ctx->encoder_graycode &= ~(1 << i);
+        } else if (value + hysteresis < ctx->config.ir_limits[i]) {
+            ctx->encoder_graycode |= (1 << i);
+        }
+        // Only a turning wheel shows both states of a sensor, a stuck one would hold a reading between them.
+        if (tracking) {
+            irTrackUpdate(ctx, i, value);
         }
     }
+    uint8_t encoder_graycode = ctx->encoder_graycode;
 
     // Convert grey code into decimal.
     uint8_t encoder_decimal = 0;
@@ -34,6 +148,18 @@ void encoderPositionUpdate(openflap_ctx_t *ctx, uint32_t *adc_data)
     // Reverse encoder direction.
     uint8_t new_position = (uint8_t)SYMBOL_CNT - encoder_decimal - 1;
 
+    // Record the range of every sensor and the codes that were decoded.
+    if (ctx->calibrating) {
+        for (uint8_t i = 0; i < ENCODER_RESOLUTION; i++) {
+            uint16_t value = adc_data[IR_MAP[i]];
+            ctx->ir_min[i] = value < ctx->ir_min[i] ? value : ctx->ir_min[i];
+            ctx->ir_max[i] = value > ctx->ir_max[i] ? value : ctx->ir_max[i];
+        }
+        if (new_position < SYMBOL_CNT) {
+            ctx->positions_seen |= (uint64_t)1 << new_position;
+        }
+    }
+
     // Ignore erroneous reading.
     if (new_position < SYMBOL_CNT) {
         new_position = flapIndexWrapCalc(new_position + ctx->config.encoder_offset);
@@ -45,6 +171,33 @@ void encoderPositionUpdate(openflap_ctx_t *ctx, uint32_t *adc_data)
     }
 }
 
+void irTrackingReset(openflap_ctx_t *ctx)
+{
+    for (uint8_t i = 0; i < SENS_CNT; i++) {
+        ctx->ir_track_min[i] = UINT16_MAX;
+        ctx->ir_track_max[i] = 0;
+        ctx->ir_track_seen[i] = 0;
+        ctx->ir_limits_flash[i] = ctx->config.ir_limits[i];
+    }
+}
+
+void updateIrLimits(openflap_ctx_t *ctx)
+{
+    for (uint8_t i = 0; i < SENS_CNT; i++) {
+        if (!irTrackRange(ctx, i)) {
+            continue;
+        }
+        uint16_t limit = (ctx->ir_track_min[i] + ctx->ir_track_max[i]) / 2;
+        ctx->config.ir_limits[i] = limit;
+        uint16_t drift = limit > ctx->ir_limits_flash[i] ? limit - ctx->ir_limits_flash[i]
+                                                          : ctx->ir_limits_flash[i] - limit;
+        if (drift >= IR_LIMIT_STORE_DRIFT) {
+            ctx->ir_limits_flash[i] = limit;
+            ctx->store_config = true;
+        }
+    }
+}
+
 uint8_t getAdcBasedRandSeed(uint32_t *adc_data)
 {
     /* Use ADC noise to generate a random number. */
@@ -56,6 +209,79 @@ uint8_t getAdcBasedRandSeed(uint32_t *adc_data)
     return rand_seed;
 }
 
+void updateSetpoint(openflap_ctx_t *ctx)
+{
+    // Compared as a signed difference, so the comparison holds when the tick counter wraps.
+    if (ctx->setpoint_pending && (int32_t)(HAL_GetTick() - ctx->setpoint_tick) >= 0) {
+        ctx->setpoint_pending = false;
+        ctx->flap_setpoint = ctx->flap_setpoint_pending;
+    }
+}
+
+void updateFlapPeriod(openflap_ctx_t *ctx)
+{
+    uint8_t distance = flapIndexWrapCalc(SYMBOL_CNT + ctx->flap_setpoint - ctx->flap_position);
+    if (distance && !ctx->moving) {
+        ctx->moving = true;
+        ctx->move_start_tick = HAL_GetTick();
+        ctx->move_position = ctx->flap_position;
+        ctx->move_flaps = 0;
+        ctx->move_stalled = false;
+    }
+    // The time of a move that needed a recovery says nothing about the speed of the wheel.
+    if (ctx->moving && (ctx->stall_retries || ctx->fault & fault_stall)) {
+        ctx->move_stalled = true;
+    }
+    if (ctx->moving && ctx->flap_position != ctx->move_position) {
+        // Counted as the wheel goes, so a move of a full revolution or more is not taken modulo the wheel.
+        ctx->move_flaps += flapIndexWrapCalc(SYMBOL_CNT + ctx->flap_position - ctx->move_position);
+        ctx->move_position = ctx->flap_position;
+    }
+    if (!distance && ctx->moving) {
+        ctx->moving = false;
+        if (!ctx->move_stalled && ctx->move_flaps >= FLAP_PERIOD_MIN_FLAPS) {
+            uint32_t period = (HAL_GetTick() - ctx->move_start_tick) / ctx->move_flaps;
+            ctx->flap_period = ctx->flap_period ? (3 * ctx->flap_period + period) / 4 : period;
+        }
+    }
+}
+
+void calibrationStart(openflap_ctx_t *ctx)
+{
+    ctx->calibrating = false; // Keep the ADC interrupt out while the statistics are reset.
+    for (uint8_t i = 0; i < SENS_CNT; i++) {
+        ctx->ir_min[i] = UINT16_MAX;
+        ctx->ir_max[i] = 0;
+    }
+    ctx->positions_seen = 0;
+    ctx->fault &= ~fault_stall; // The revolution retries a stalled motor.
+    ctx->calibration_timeout_tick = HAL_GetTick() + CALIBRATION_TIMEOUT;
+    ctx->setpoint_pending = false;
+    ctx->flap_setpoint = flapIndexWrapCalc(ctx->flap_position - 1);
+    ctx->calibrating = true;
+    debug_io_log_info("Calibration started\n");
+}
+
+void updateCalibration(openflap_ctx_t *ctx)
+{
+    if (!ctx->calibrating) {
+        return;
+    }
+    if (ctx->fault & fault_stall) {
+        // The motor gave up on the setpoint, so the revolution did not complete.
+        ctx->calibrating = false;
+        debug_io_log_error("Calibration failed, motor stalled\n");
+    } else if (ctx->flap_setpoint == ctx->flap_position) {
+        ctx->calibrating = false;
+        debug_io_log_info("Calibration done\n");
+    } else if ((int32_t)(HAL_GetTick() - ctx->calibration_timeout_tick) > 0) {
+        // The wheel does not reach its setpoint, likely because the current limits do not decode every position.
+        ctx->calibrating = false;
+        ctx->flap_setpoint = ctx->flap_position;
+        debug_io_log_info("Calibration timed out\n");
+    }
+}
+
 void updateMotorState(openflap_ctx_t *ctx)
 {
     uint8_t distance = flapIndexWrapCalc(SYMBOL_CNT + ctx->flap_setpoint - ctx->flap_position);
@@ -78,11 +304,13 @@ void updateCommsState(openflap_ctx_t *ctx)
         if (!ctx->comms_active) {
             ctx->comms_active = true;
             debug_io_log_info("Comms Active\n");
-            debug_io_log_disable(); // Writing to RTT may fuck up the UART RX interrupt...
+            debug_io_log_defer(); // Formatting to RTT may fuck up the UART RX interrupt, so only record the logs.
         }
     } else if (ctx->comms_active && HAL_GetTick() > ctx->comms_active_timeout_tick) {
         ctx->comms_active = false;
-        debug_io_log_enable();
+        debug_io_log_enable(); // Writes the deferred logs.
         debug_io_log_info("Comms Idle\n");
+    } else if (!ctx->comms_active) {
+        debug_io_log_flush(); // Deferred logs that did not fit in the RTT buffer yet.
     }
 }
\ No newline at end of file
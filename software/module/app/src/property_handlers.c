@@ -25,6 +25,9 @@ void command_property_set(uint8_t *buf)
             /* Reboot is handled later to allow graceful end of communication. */
             openflap_ctx->reboot = true;
             break;
+        case calibrate_command:
+            calibrationStart(openflap_ctx);
+            break;
         default:
             break;
     }
@@ -79,14 +82,31 @@ void vtrim_property_get(uint8_t *buf)
     buf[0] = openflap_ctx->config.vtrim;
 }
 
+void characterDelay_property_set(uint8_t *buf)
+{
+    openflap_ctx->character_delay = (uint16_t)buf[0] | (uint16_t)buf[1] << 8;
+}
+
 void character_property_set(uint8_t *buf)
 {
-    openflap_ctx->flap_setpoint = buf[0];
+    /* A new character retries a stalled motor. */
+    openflap_ctx->fault &= ~fault_stall;
+    /* The character delay only applies to the character that follows it in the same update. */
+    if (openflap_ctx->character_delay) {
+        openflap_ctx->flap_setpoint_pending = buf[0];
+        openflap_ctx->setpoint_tick = HAL_GetTick() + openflap_ctx->character_delay;
+        openflap_ctx->setpoint_pending = true;
+        openflap_ctx->character_delay = 0;
+    } else {
+        openflap_ctx->setpoint_pending = false;
+        openflap_ctx->flap_setpoint = buf[0];
+    }
 }
 
 void character_property_get(uint8_t *buf)
 {
-    buf[0] = openflap_ctx->flap_position;
+    /* A character waiting for its delay is reported, so the controller does not send it again. */
+    buf[0] = openflap_ctx->setpoint_pending ? openflap_ctx->flap_setpoint_pending : openflap_ctx->flap_position;
 }
 
 void baseSpeed_property_set(uint8_t *buf)
@@ -103,6 +123,90 @@ void baseSpeed_property_get(uint8_t *buf)
     buf[0] = openflap_ctx->config.base_speed;
 }
 
+/**
+ * \brief Update a CRC-16/CCITT checksum with a block of data.
+ *
+ * \param[in] crc The checksum of the preceding data.
+ * \param[in] data The data to add to the checksum.
+ * \param[in] len The number of bytes of data.
+ * \return The updated checksum.
+ */
+static uint16_t crc16_update(uint16_t crc, const uint8_t *data, uint32_t len)
+{
+    while (len--) {
+        crc ^= (uint16_t)*data++ << 8;
+        for (uint8_t i = 0; i < 8; i++) {
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+void configChecksum_property_get(uint8_t *buf)
+{
+    /* Covers everything the controller keeps in its snapshot of the module. */
+    uint8_t col_end = HAL_GPIO_ReadPin(GPIO_PORT_COLEND, GPIO_PIN_COLEND);
+    uint16_t crc = 0xffff;
+    crc = crc16_update(crc, &col_end, 1);
+    crc = crc16_update(crc, &openflap_ctx->config.encoder_offset, 1);
+    crc = crc16_update(crc, &openflap_ctx->config.vtrim, 1);
+    crc = crc16_update(crc, &openflap_ctx->config.base_speed, 1);
+    crc = crc16_update(crc, (uint8_t *)openflap_ctx->config.symbol_set, 4 * SYMBOL_CNT);
+    buf[0] = crc & 0xff;
+    buf[1] = crc >> 8;
+}
+
+void flapPeriod_property_get(uint8_t *buf)
+{
+    buf[0] = openflap_ctx->flap_period & 0xff;
+    buf[1] = openflap_ctx->flap_period >> 8;
+}
+
+void encoderStats_property_get(uint8_t *buf)
+{
+    /* [calibrating] [positions seen] [min of each sensor] [max of each sensor], 16 bit values are little endian. */
+    uint8_t positions_seen = 0;
+    for (uint64_t seen = openflap_ctx->positions_seen; seen; seen &= seen - 1) {
+        positions_seen++;
+    }
+    buf[0] = openflap_ctx->calibrating;
+    buf[1] = positions_seen;
+    for (uint8_t i = 0; i < SENS_CNT; i++) {
+        buf[2 + 2 * i] = openflap_ctx->ir_min[i] & 0xff;
+        buf[3 + 2 * i] = openflap_ctx->ir_min[i] >> 8;
+        buf[2 + 2 * SENS_CNT + 2 * i] = openflap_ctx->ir_max[i] & 0xff;
+        buf[3 + 2 * SENS_CNT + 2 * i] = openflap_ctx->ir_max[i] >> 8;
+    }
+}
+
+void irLimits_property_set(uint8_t *buf)
+{
+    uint16_t ir_limits[SENS_CNT];
+    for (uint8_t i = 0; i < SENS_CNT; i++) {
+        ir_limits[i] = (uint16_t)buf[2 * i] | (uint16_t)buf[2 * i + 1] << 8;
+    }
+    if (!memcmp(openflap_ctx->config.ir_limits, ir_limits, sizeof(ir_limits))) {
+        return;
+    }
+    memcpy(openflap_ctx->config.ir_limits, ir_limits, sizeof(ir_limits));
+    openflap_ctx->store_config = true;
+    /* The written thresholds hold until the sensors have shown their range again. */
+    irTrackingReset(openflap_ctx);
+}
+
+void irLimits_property_get(uint8_t *buf)
+{
+    for (uint8_t i = 0; i < SENS_CNT; i++) {
+        buf[2 * i] = openflap_ctx->config.ir_limits[i] & 0xff;
+        buf[2 * i + 1] = openflap_ctx->config.ir_limits[i] >> 8;
+    }
+}
+
+void fault_property_get(uint8_t *buf)
+{
+    buf[0] = openflap_ctx->fault;
+}
+
 void property_handlers_init(openflap_ctx_t *ctx)
 {
     openflap_ctx = ctx;
@@ -128,9 +232,27 @@ void property_handlers_init(openflap_ctx_t *ctx)
     openflap_ctx->chain_ctx.property_handler[characterMap_property].set = characterMap_property_set;
     openflap_ctx->chain_ctx.property_handler[characterMap_property].get = characterMap_property_get;
 
+    openflap_ctx->chain_ctx.property_handler[characterDelay_property].set = characterDelay_property_set;
+    openflap_ctx->chain_ctx.property_handler[characterDelay_property].get = NULL;
+
     openflap_ctx->chain_ctx.property_handler[character_property].set = character_property_set;
     openflap_ctx->chain_ctx.property_handler[character_property].get = character_property_get;
 
     openflap_ctx->chain_ctx.property_handler[baseSpeed_property].set = baseSpeed_property_set;
     openflap_ctx->chain_ctx.property_handler[baseSpeed_property].get = baseSpeed_property_get;
+
+    openflap_ctx->chain_ctx.property_handler[configChecksum_property].set = NULL;
+    openflap_ctx->chain_ctx.property_handler[configChecksum_property].get = configChecksum_property_get;
+
+    openflap_ctx->chain_ctx.property_handler[flapPeriod_property].set = NULL;
+    openflap_ctx->chain_ctx.property_handler[flapPeriod_property].get = flapPeriod_property_get;
+
+    openflap_ctx->chain_ctx.property_handler[encoderStats_property].set = NULL;
+    openflap_ctx->chain_ctx.property_handler[encoderStats_property].get = encoderStats_property_get;
+
+    openflap_ctx->chain_ctx.property_handler[irLimits_property].set = irLimits_property_set;
+    openflap_ctx->chain_ctx.property_handler[irLimits_property].get = irLimits_property_get;
+
+    openflap_ctx->chain_ctx.property_handler[fault_property].set = NULL;
+    openflap_ctx->chain_ctx.property_handler[fault_property].get = fault_property_get;
 }
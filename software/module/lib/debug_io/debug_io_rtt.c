@@ -9,16 +9,79 @@ static bool format_ended_in_newline = true;
 static log_lvl_t active_log_lvl = LOG_DISBALED;
 static log_lvl_t prev_log_lvl = LOG_DISBALED;
 
+/*
+ * A deferred record starts with a header word holding the level (bits 28-31), the number of argument words (bits 24-27)
+ * and the offset of the format string in flash (bits 0-23). The argument words follow the header. A record with a
+ * format offset of 0 reports the number of dropped records in its argument.
+ */
+#define DEFER_FLASH_BASE 0x08000000u
+static bool log_deferred = false;
+static uint32_t defer_ring[DEBUG_IO_DEFER_RING_WORDS];
+static uint16_t defer_head = 0;
+static uint16_t defer_tail = 0;
+static uint16_t defer_dropped = 0;
+static char defer_rtt_buffer[DEBUG_IO_DEFER_BUFFER_SIZE];
+
 static inline bool format_end_in_newline(const char *fmt)
 {
     return (fmt[0] != 0) && (fmt[strlen(fmt) - 1] == '\n');
 }
 
+static void defer_push(const uint32_t *record, uint8_t len)
+{
+    uint16_t used = (uint16_t)(defer_head - defer_tail);
+    if (used + len > DEBUG_IO_DEFER_RING_WORDS) {
+        defer_dropped++;
+        return;
+    }
+    for (uint8_t i = 0; i < len; i++) {
+        defer_ring[(defer_head + i) & (DEBUG_IO_DEFER_RING_WORDS - 1)] = record[i];
+    }
+    defer_head += len;
+}
+
+/**
+ * \brief Store a message without formatting it.
+ * Only the argument words are collected from the format string, a "ll" length modifier takes two words.
+ */
+static void defer_log(log_lvl_t log_lvl, const char *fmt, va_list *args)
+{
+    uint32_t record[1 + DEBUG_IO_DEFER_MAX_ARGS];
+    uint8_t argc = 0;
+    for (const char *c = fmt; *c && argc < DEBUG_IO_DEFER_MAX_ARGS; c++) {
+        if (*c != '%' || *++c == '%') {
+            continue;
+        }
+        bool is_long_long = false;
+        for (; *c && strchr("-+ #0123456789.*lhz", *c); c++) {
+            if (*c == '*') {
+                record[1 + argc++] = va_arg(*args, uint32_t);
+            } else if (*c == 'l' && c[1] == 'l') {
+                is_long_long = true;
+            }
+        }
+        if (!*c) {
+            break;
+        }
+        if (is_long_long && argc + 2 <= DEBUG_IO_DEFER_MAX_ARGS) {
+            uint64_t value = va_arg(*args, uint64_t);
+            record[1 + argc++] = (uint32_t)value;
+            record[1 + argc++] = (uint32_t)(value >> 32);
+        } else if (!is_long_long && argc < DEBUG_IO_DEFER_MAX_ARGS) {
+            record[1 + argc++] = va_arg(*args, uint32_t);
+        }
+    }
+    record[0] = ((uint32_t)log_lvl << 28) | ((uint32_t)argc << 24) | (((uint32_t)fmt - DEFER_FLASH_BASE) & 0xffffff);
+    defer_push(record, 1 + argc);
+}
+
 void debug_io_init(log_lvl_t log_lvl)
 {
     active_log_lvl = log_lvl;
     prev_log_lvl = log_lvl;
     SEGGER_RTT_Init();
+    SEGGER_RTT_ConfigUpBuffer(DEBUG_IO_DEFER_CHANNEL, "DeferredLog", defer_rtt_buffer, sizeof(defer_rtt_buffer),
+                              SEGGER_RTT_MODE_NO_BLOCK_SKIP);
 }
 
 int debug_io_get(void)
@@ -31,13 +94,17 @@ void debug_io_log_debug(const char *fmt, ...)
     if (active_log_lvl < LOG_LVL_DEBUG) {
         return;
     }
-    if (format_ended_in_newline) {
-        SEGGER_RTT_Write(0, RTT_CTRL_TEXT_WHITE "D " RTT_CTRL_RESET, 14);
-    }
-    format_ended_in_newline = format_end_in_newline(fmt);
     va_list args;
     va_start(args, fmt);
-    SEGGER_RTT_vprintf(0, fmt, &args);
+    if (log_deferred) {
+        defer_log(LOG_LVL_DEBUG, fmt, &args);
+    } else {
+        if (format_ended_in_newline) {
+            SEGGER_RTT_Write(0, RTT_CTRL_TEXT_WHITE "D " RTT_CTRL_RESET, 14);
+        }
+        format_ended_in_newline = format_end_in_newline(fmt);
+        SEGGER_RTT_vprintf(0, fmt, &args);
+    }
     va_end(args);
 }
 void debug_io_log_info(const char *fmt, ...)
@@ -45,13 +112,17 @@ void debug_io_log_info(const char *fmt, ...)
     if (active_log_lvl < LOG_LVL_INFO) {
         return;
     }
-    if (format_ended_in_newline) {
-        SEGGER_RTT_Write(0, RTT_CTRL_TEXT_BRIGHT_CYAN "I " RTT_CTRL_RESET, 14);
-    }
-    format_ended_in_newline = format_end_in_newline(fmt);
     va_list args;
     va_start(args, fmt);
-    SEGGER_RTT_vprintf(0, fmt, &args);
+    if (log_deferred) {
+        defer_log(LOG_LVL_INFO, fmt, &args);
+    } else {
+        if (format_ended_in_newline) {
+            SEGGER_RTT_Write(0, RTT_CTRL_TEXT_BRIGHT_CYAN "I " RTT_CTRL_RESET, 14);
+        }
+        format_ended_in_newline = format_end_in_newline(fmt);
+        SEGGER_RTT_vprintf(0, fmt, &args);
+    }
     va_end(args);
 }
 void debug_io_log_warn(const char *fmt, ...)
@@ -59,13 +130,17 @@ void debug_io_log_warn(const char *fmt, ...)
     if (active_log_lvl < LOG_LVL_WARN) {
         return;
     }
-    if (format_ended_in_newline) {
-        SEGGER_RTT_Write(0, RTT_CTRL_TEXT_BRIGHT_YELLOW "W " RTT_CTRL_RESET, 14);
-    }
-    format_ended_in_newline = format_end_in_newline(fmt);
     va_list args;
     va_start(args, fmt);
-    SEGGER_RTT_vprintf(0, fmt, &args);
+    if (log_deferred) {
+        defer_log(LOG_LVL_WARN, fmt, &args);
+    } else {
+        if (format_ended_in_newline) {
+            SEGGER_RTT_Write(0, RTT_CTRL_TEXT_BRIGHT_YELLOW "W " RTT_CTRL_RESET, 14);
+        }
+        format_ended_in_newline = format_end_in_newline(fmt);
+        SEGGER_RTT_vprintf(0, fmt, &args);
+    }
     va_end(args);
 }
 void debug_io_log_error(const char *fmt, ...)
@@ -73,13 +148,17 @@ void debug_io_log_error(const char *fmt, ...)
     if (active_log_lvl < LOG_LVL_ERROR) {
         return;
     }
-    if (format_ended_in_newline) {
-        SEGGER_RTT_Write(0, RTT_CTRL_TEXT_BRIGHT_RED "E " RTT_CTRL_RESET, 14);
-    }
-    format_ended_in_newline = format_end_in_newline(fmt);
     va_list args;
     va_start(args, fmt);
-    SEGGER_RTT_vprintf(0, fmt, &args);
+    if (log_deferred) {
+        defer_log(LOG_LVL_ERROR, fmt, &args);
+    } else {
+        if (format_ended_in_newline) {
+            SEGGER_RTT_Write(0, RTT_CTRL_TEXT_BRIGHT_RED "E " RTT_CTRL_RESET, 14);
+        }
+        format_ended_in_newline = format_end_in_newline(fmt);
+        SEGGER_RTT_vprintf(0, fmt, &args);
+    }
     va_end(args);
 }
 
@@ -102,4 +181,33 @@ void debug_io_log_disable(void)
 void debug_io_log_enable(void)
 {
     active_log_lvl = prev_log_lvl;
+    log_deferred = false;
+    debug_io_log_flush();
+}
+
+void debug_io_log_defer(void)
+{
+    active_log_lvl = prev_log_lvl;
+    log_deferred = true;
+}
+
+void debug_io_log_flush(void)
+{
+    if (defer_dropped) {
+        uint32_t record[2] = {1u << 24, defer_dropped};
+        if (SEGGER_RTT_Write(DEBUG_IO_DEFER_CHANNEL, record, sizeof(record))) {
+            defer_dropped = 0;
+        }
+    }
+    while (defer_tail != defer_head) {
+        uint32_t record[1 + DEBUG_IO_DEFER_MAX_ARGS];
+        uint8_t len = 1 + ((defer_ring[defer_tail & (DEBUG_IO_DEFER_RING_WORDS - 1)] >> 24) & 0xf);
+        for (uint8_t i = 0; i < len; i++) {
+            record[i] = defer_ring[(defer_tail + i) & (DEBUG_IO_DEFER_RING_WORDS - 1)];
+        }
+        if (!SEGGER_RTT_Write(DEBUG_IO_DEFER_CHANNEL, record, len * sizeof(uint32_t))) {
+            return; // the RTT buffer is full, try again later.
+        }
+        defer_tail += len;
+    }
 }
\ No newline at end of file
@@ -79,9 +79,10 @@ Revision: $Rev: 24316 $
 // Most common case:
 // Up-channel 0: RTT
 // Up-channel 1: SystemView
+// OpenFlap uses up-channel 1 for deferred binary logs.
 //
 #ifndef SEGGER_RTT_MAX_NUM_UP_BUFFERS
-#define SEGGER_RTT_MAX_NUM_UP_BUFFERS (1) // Max. number of up-buffers (T->H) available on this target    (Default: 3)
+#define SEGGER_RTT_MAX_NUM_UP_BUFFERS (2) // Max. number of up-buffers (T->H) available on this target    (Default: 3)
 #endif
 //
 // Most common case:
@@ -1,5 +1,12 @@
 #pragma once
 
+#include <stdint.h>
+
+#define DEBUG_IO_DEFER_CHANNEL     1   // RTT up-channel of the deferred log records.
+#define DEBUG_IO_DEFER_RING_WORDS  128 // must be a power of 2.
+#define DEBUG_IO_DEFER_MAX_ARGS    6   // argument words stored per record.
+#define DEBUG_IO_DEFER_BUFFER_SIZE 256 // size of the RTT up-buffer of the deferred log records.
+
 typedef enum log_lvl_tag {
     LOG_DISBALED = 0,
     LOG_LVL_ERROR = 1,
@@ -77,4 +84,18 @@ void debug_io_log_disable(void);
  * \brief Enable the debug IO.
  * The last configured log level will be used.
  */
-void debug_io_log_enable(void);
\ No newline at end of file
+void debug_io_log_enable(void);
+
+/**
+ * \brief Defer logging.
+ * Instead of formatting a message, its format string address and raw arguments are stored in a RAM ring. The records
+ * are written to RTT channel DEBUG_IO_DEFER_CHANNEL when logging is enabled again and formatted on the host by
+ * tools/decode_deferred_log.py. Logging must not be deferred from an interrupt.
+ */
+void debug_io_log_defer(void);
+
+/**
+ * \brief Write deferred log records to RTT.
+ * Records that do not fit in the RTT buffer stay in the ring until the next call.
+ */
+void debug_io_log_flush(void);
@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""Decode the deferred log records that the module writes to RTT up-channel 1.
+
+While the chain is busy the module does not format its log messages. It stores the flash offset of the format string
+and the raw argument words instead (see lib/debug_io/debug_io_rtt.c). This tool formats these records on the host,
+using the format strings from the application ELF file.
+
+Usage:
+    pyocd rtt --up-channel-id 1 ... > deferred.bin
+    decode_deferred_log.py build/app/<project>_App.elf deferred.bin
+
+The "rtt_deferred" target runs both steps.
+
+Requires pyelftools.
+"""
+import argparse
+import re
+import struct
+import sys
+
+from elftools.elf.elffile import ELFFile
+
+FLASH_BASE = 0x08000000
+LEVELS = {1: "E", 2: "W", 3: "I", 4: "D"}
+SPECIFIER = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?(hh|h|ll|l|z)?([diuxXcspo%])")
+
+
+class Image:
+    def __init__(self, elf_file):
+        elf = ELFFile(elf_file)
+        self.segments = [(s["p_paddr"], s.data()) for s in elf.iter_segments() if s["p_type"] == "PT_LOAD"]
+
+    def string(self, address):
+        for base, data in self.segments:
+            if base <= address < base + len(data):
+                start = address - base
+                return data[start:data.index(b"\0", start)].decode("utf-8", "replace")
+        return None
+
+
+def format_record(image, fmt, words):
+    words = list(words)
+
+    def take():
+        return words.pop(0) if words else 0
+
+    def convert(match):
+        flags, width, precision, length, conversion = match.groups()
+        if conversion == "%":
+            return "%"
+        if width == "*":
+            width = str(take())
+        if precision == "*":
+            precision = str(take())
+        value = take()
+        if length == "ll":
+            value |= take() << 32
+        if conversion in "di":
+            bits = 64 if length == "ll" else 32
+            value = value - (1 << bits) if value & (1 << (bits - 1)) else value
+            conversion = "d"
+        elif conversion == "u":
+            conversion = "d"
+        elif conversion == "c":
+            value = chr(value & 0xFF)
+        elif conversion == "s":
+            value = image.string(value)
+            if value is None:
+                value = "<ram string>"
+        elif conversion == "p":
+            value, conversion = "0x%08x" % value, "s"
+        spec = "%" + flags + (width or "") + ("." + precision if precision else "") + conversion
+        return spec % value
+
+    return SPECIFIER.sub(convert, fmt)
+
+
+def decode(image, stream, out):
+    while True:
+        header = stream.read(4)
+        if len(header) < 4:
+            return
+        (header,) = struct.unpack("<I", header)
+        level = header >> 28
+        argc = (header >> 24) & 0xF
+        offset = header & 0xFFFFFF
+        words = struct.unpack("<%dI" % argc, stream.read(4 * argc))
+        if offset == 0:
+            out.write("<%d deferred log records dropped>\n" % (words[0] if words else 0))
+            continue
+        fmt = image.string(FLASH_BASE + offset)
+        if fmt is None:
+            out.write("<unknown format string at 0x%08x>\n" % (FLASH_BASE + offset))
+            continue
+        out.write("%s %s" % (LEVELS.get(level, "?"), format_record(image, fmt, words)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf", type=argparse.FileType("rb"), help="application ELF file of the module firmware")
+    parser.add_argument("log", nargs="?", type=argparse.FileType("rb"), default=sys.stdin.buffer,
+                        help="binary capture of RTT up-channel 1 (default: stdin)")
+    args = parser.parse_args()
+    decode(Image(args.elf), args.log, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()